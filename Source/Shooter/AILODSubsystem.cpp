@@ -0,0 +1,406 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AILODSubsystem.h"
+#include "Enemy.h"
+#include "EnemyController.h"
+#include "EnemyBehaviorTreeComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "RenderCore.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI LOD update"), STAT_AILODUpdate, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI LOD full"), STAT_AILODFull, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI LOD near"), STAT_AILODNear, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI LOD far"), STAT_AILODFar, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI LOD dormant"), STAT_AILODDormant, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarAILOD(
+	TEXT("shooter.AILOD"),
+	1,
+	TEXT("0 runs every enemy at full rate."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAILODUpdateInterval(
+	TEXT("shooter.AILODUpdateInterval"),
+	0.25f,
+	TEXT("Seconds between two tier evaluations of an enemy."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAILODNearDistance(
+	TEXT("shooter.AILODNearDistance"),
+	2500.f,
+	TEXT("Visible enemies closer to a player than this are near, further ones far."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAILODFarDistance(
+	TEXT("shooter.AILODFarDistance"),
+	6000.f,
+	TEXT("Enemies out of view closer to a player than this are far, further ones dormant."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAILODCombatTime(
+	TEXT("shooter.AILODCombatTime"),
+	5.f,
+	TEXT("Seconds an enemy stays at full rate after damage or aggro."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAILODNearInterval(
+	TEXT("shooter.AILODNearInterval"),
+	0.1f,
+	TEXT("Think interval of near enemies."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAILODFarInterval(
+	TEXT("shooter.AILODFarInterval"),
+	0.25f,
+	TEXT("Think interval of far enemies."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarAILODDormantInterval(
+	TEXT("shooter.AILODDormantInterval"),
+	1.f,
+	TEXT("Think interval of dormant enemies."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs AILODBenchmarkCommand(
+	TEXT("shooter.AILODBenchmark"),
+	TEXT("Spawns copies of the first enemy on a grid next to it until there are EnemyCount,\n")
+	TEXT("then logs the game thread time per frame with every enemy at full rate and with AI LOD.\n")
+	TEXT("Keep the player away from the enemies so they stay idle.\n")
+	TEXT("shooter.AILODBenchmark [EnemyCount=500] [FrameCount=300]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 EnemyCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 500;
+		const int32 FrameCount = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 300, 1);
+
+		UAILODSubsystem* AILOD = World ? World->GetSubsystem<UAILODSubsystem>() : nullptr;
+		if (AILOD)
+		{
+			AILOD->StartBenchmark(EnemyCount, FrameCount);
+		}
+	}));
+
+// frames before each measurement, the tiers and tick intervals settle in
+static constexpr int32 BenchmarkSettleFrames = 30;
+
+static float GetThinkInterval(EAILODTier Tier)
+{
+	switch (Tier)
+	{
+	case EAILODTier::EALT_Near:
+		return CVarAILODNearInterval.GetValueOnGameThread();
+	case EAILODTier::EALT_Far:
+		return CVarAILODFarInterval.GetValueOnGameThread();
+	case EAILODTier::EALT_Dormant:
+		return CVarAILODDormantInterval.GetValueOnGameThread();
+	default:
+		return 0.f;
+	}
+}
+
+void UAILODSubsystem::Deinitialize()
+{
+	Entries.Reset();
+	PendingBlackboardFlushes.Reset();
+	BenchmarkEnemies.Reset();
+	BenchmarkFrameCount = 0;
+
+	Super::Deinitialize();
+}
+
+void UAILODSubsystem::RegisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy == nullptr)
+	{
+		return;
+	}
+
+	FAILODEntry Entry;
+	Entry.Enemy = Enemy;
+	Entry.Tier = EAILODTier::EALT_Full;
+	Entry.PromoteTime = -BIG_NUMBER;
+	Entry.AnimTickOption = Enemy->GetMesh()->VisibilityBasedAnimTickOption;
+	Entries.Add(Entry);
+
+	++TierCounts[static_cast<int32>(EAILODTier::EALT_Full)];
+}
+
+void UAILODSubsystem::UnregisterEnemy(AEnemy* Enemy)
+{
+	const int32 Index = Entries.IndexOfByPredicate([Enemy](const FAILODEntry& Other) { return Other.Enemy.Get() == Enemy; });
+	if (Index != INDEX_NONE)
+	{
+		// pooled enemies come back with their own tick settings
+		if (Entries[Index].Enemy.IsValid())
+		{
+			ApplyTier(Entries[Index], EAILODTier::EALT_Full);
+		}
+		RemoveEntry(Index);
+	}
+}
+
+void UAILODSubsystem::RemoveEntry(int32 Index)
+{
+	--TierCounts[static_cast<int32>(Entries[Index].Tier)];
+	Entries.RemoveAtSwap(Index, 1, false);
+}
+
+void UAILODSubsystem::QueueBlackboardFlush(AEnemyController* Controller)
+{
+	PendingBlackboardFlushes.Add(Controller);
+}
+
+void UAILODSubsystem::PromoteToFullRate(AEnemy* Enemy)
+{
+	FAILODEntry* Entry = Entries.FindByPredicate([Enemy](const FAILODEntry& Other) { return Other.Enemy.Get() == Enemy; });
+	if (Entry)
+	{
+		Entry->PromoteTime = GetWorld()->GetTimeSeconds();
+		ApplyTier(*Entry, EAILODTier::EALT_Full);
+	}
+}
+
+EAILODTier UAILODSubsystem::GetTier(const AEnemy* Enemy) const
+{
+	const FAILODEntry* Entry = Entries.FindByPredicate([Enemy](const FAILODEntry& Other) { return Other.Enemy.Get() == Enemy; });
+	return Entry ? Entry->Tier : EAILODTier::EALT_Full;
+}
+
+EAILODTier UAILODSubsystem::EvaluateTier(const FAILODEntry& Entry, const TArray<FVector, TInlineAllocator<4>>& PlayerLocations) const
+{
+	if (bForceFullRate || CVarAILOD.GetValueOnGameThread() == 0)
+	{
+		return EAILODTier::EALT_Full;
+	}
+
+	const AEnemy* Enemy = Entry.Enemy.Get();
+	if (Enemy->IsInCombat() || GetWorld()->GetTimeSeconds() - Entry.PromoteTime < CVarAILODCombatTime.GetValueOnGameThread())
+	{
+		return EAILODTier::EALT_Full;
+	}
+
+	float DistanceSquared = BIG_NUMBER;
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		DistanceSquared = FMath::Min(DistanceSquared, FVector::DistSquared(PlayerLocation, Enemy->GetActorLocation()));
+	}
+
+	if (Enemy->GetMesh()->WasRecentlyRendered(0.2f))
+	{
+		return DistanceSquared < FMath::Square(CVarAILODNearDistance.GetValueOnGameThread()) ? EAILODTier::EALT_Near : EAILODTier::EALT_Far;
+	}
+	return DistanceSquared < FMath::Square(CVarAILODFarDistance.GetValueOnGameThread()) ? EAILODTier::EALT_Far : EAILODTier::EALT_Dormant;
+}
+
+void UAILODSubsystem::ApplyTier(FAILODEntry& Entry, EAILODTier Tier)
+{
+	if (Entry.Tier == Tier)
+	{
+		return;
+	}
+
+	--TierCounts[static_cast<int32>(Entry.Tier)];
+	++TierCounts[static_cast<int32>(Tier)];
+	Entry.Tier = Tier;
+
+	// the cooldown already scheduled at the old interval changes too, a promoted enemy ticks next frame
+	AEnemy* Enemy = Entry.Enemy.Get();
+	const float Interval = GetThinkInterval(Tier);
+	Enemy->PrimaryActorTick.UpdateTickIntervalAndCoolDown(Interval);
+
+	// movement and path following keep ticking every frame so patrols stay smooth
+	AEnemyController* Controller = Cast<AEnemyController>(Enemy->GetController());
+	if (Controller)
+	{
+		Controller->PrimaryActorTick.UpdateTickIntervalAndCoolDown(Interval);
+
+		UEnemyBehaviorTreeComponent* BehaviorTreeComponent = Cast<UEnemyBehaviorTreeComponent>(Controller->GetBrainComponent());
+		if (BehaviorTreeComponent)
+		{
+			BehaviorTreeComponent->SetThinkInterval(Interval);
+		}
+	}
+
+	// far enemies don't need a pose while nobody sees them
+	Enemy->GetMesh()->VisibilityBasedAnimTickOption = Tier >= EAILODTier::EALT_Far
+		? EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered
+		: Entry.AnimTickOption;
+}
+
+void UAILODSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AILODUpdate);
+
+	if (BenchmarkFrameCount > 0)
+	{
+		UpdateBenchmark();
+	}
+
+	TArray<FVector, TInlineAllocator<4>> PlayerLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APawn* PlayerPawn = It->Get() ? It->Get()->GetPawn() : nullptr;
+		if (PlayerPawn)
+		{
+			PlayerLocations.Add(PlayerPawn->GetActorLocation());
+		}
+	}
+
+	// spread the evaluations so every enemy gets one per update interval
+	const float UpdateInterval = FMath::Max(CVarAILODUpdateInterval.GetValueOnGameThread(), 0.01f);
+	PendingEvaluations = FMath::Min(PendingEvaluations + Entries.Num() * DeltaTime / UpdateInterval, static_cast<float>(Entries.Num()));
+
+	int32 Evaluations = FMath::FloorToInt(PendingEvaluations);
+	PendingEvaluations -= Evaluations;
+
+	for (; Evaluations > 0 && Entries.Num() > 0; --Evaluations)
+	{
+		if (NextEntry >= Entries.Num())
+		{
+			NextEntry = 0;
+		}
+
+		FAILODEntry& Entry = Entries[NextEntry];
+		if (!Entry.Enemy.IsValid())
+		{
+			RemoveEntry(NextEntry);
+			continue;
+		}
+
+		ApplyTier(Entry, EvaluateTier(Entry, PlayerLocations));
+		++NextEntry;
+	}
+
+	// throttled controllers can't wait for their own tick, only the ones written to this frame are visited
+	for (const TWeakObjectPtr<AEnemyController>& Controller : PendingBlackboardFlushes)
+	{
+		if (Controller.IsValid())
+		{
+			Controller->GetEnemyBlackboard().Flush();
+		}
+	}
+	PendingBlackboardFlushes.Reset();
+
+	SET_DWORD_STAT(STAT_AILODFull, TierCounts[static_cast<int32>(EAILODTier::EALT_Full)]);
+	SET_DWORD_STAT(STAT_AILODNear, TierCounts[static_cast<int32>(EAILODTier::EALT_Near)]);
+	SET_DWORD_STAT(STAT_AILODFar, TierCounts[static_cast<int32>(EAILODTier::EALT_Far)]);
+	SET_DWORD_STAT(STAT_AILODDormant, TierCounts[static_cast<int32>(EAILODTier::EALT_Dormant)]);
+}
+
+void UAILODSubsystem::StartBenchmark(int32 EnemyCount, int32 FrameCount)
+{
+	if (BenchmarkFrameCount > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AILODBenchmark: already running"));
+		return;
+	}
+
+	const FAILODEntry* TemplateEntry = Entries.FindByPredicate([](const FAILODEntry& Other) { return Other.Enemy.IsValid(); });
+	if (TemplateEntry == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AILODBenchmark: needs at least one enemy in the level"));
+		return;
+	}
+
+	AEnemy* Template = TemplateEntry->Enemy.Get();
+	const FVector Origin = Template->GetActorLocation();
+	UWorld* World = GetWorld();
+
+	for (int32 Index = Entries.Num(); Index < EnemyCount; ++Index)
+	{
+		const FTransform SpawnTransform(Origin + FVector((Index % 25) * 400.f, (Index / 25 + 1) * 400.f, 0.f));
+		AEnemy* Enemy = World->SpawnActorDeferred<AEnemy>(Template->GetClass(), SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (Enemy)
+		{
+			// spawned enemies need a controller to patrol
+			Enemy->AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
+			UGameplayStatics::FinishSpawningActor(Enemy, SpawnTransform);
+			BenchmarkEnemies.Add(Enemy);
+		}
+	}
+
+	bForceFullRate = true;
+	for (FAILODEntry& Entry : Entries)
+	{
+		if (Entry.Enemy.IsValid())
+		{
+			ApplyTier(Entry, EAILODTier::EALT_Full);
+		}
+	}
+
+	BenchmarkFrame = 0;
+	BenchmarkFrameCount = FrameCount;
+	BenchmarkFullRateMs = 0.0;
+	BenchmarkLODMs = 0.0;
+
+	UE_LOG(LogTemp, Log, TEXT("AILODBenchmark: %d enemies, measuring %d frames at full rate and %d frames with AI LOD"), Entries.Num(), FrameCount, FrameCount);
+}
+
+void UAILODSubsystem::UpdateBenchmark()
+{
+	// game thread time of the last frame
+	const double GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+
+	const int32 FullRateEnd = BenchmarkSettleFrames + BenchmarkFrameCount;
+	const int32 LODStart = FullRateEnd + BenchmarkSettleFrames;
+	const int32 LODEnd = LODStart + BenchmarkFrameCount;
+
+	if (BenchmarkFrame >= BenchmarkSettleFrames && BenchmarkFrame < FullRateEnd)
+	{
+		BenchmarkFullRateMs += GameThreadMs;
+	}
+	else if (BenchmarkFrame == FullRateEnd)
+	{
+		// every enemy gets its tier on this frame
+		bForceFullRate = false;
+		PendingEvaluations = Entries.Num();
+	}
+	else if (BenchmarkFrame >= LODStart && BenchmarkFrame < LODEnd)
+	{
+		BenchmarkLODMs += GameThreadMs;
+	}
+	else if (BenchmarkFrame >= LODEnd)
+	{
+		FinishBenchmark();
+		return;
+	}
+
+	++BenchmarkFrame;
+}
+
+void UAILODSubsystem::FinishBenchmark()
+{
+	const double FullRateMs = BenchmarkFullRateMs / BenchmarkFrameCount;
+	const double LODMs = BenchmarkLODMs / BenchmarkFrameCount;
+
+	UE_LOG(LogTemp, Log, TEXT("AILODBenchmark: %d enemies - full rate %.2f ms, AI LOD %.2f ms game thread per frame (%.1fx), tiers full %d near %d far %d dormant %d"),
+		Entries.Num(), FullRateMs, LODMs, LODMs > 0.0 ? FullRateMs / LODMs : 0.0,
+		TierCounts[static_cast<int32>(EAILODTier::EALT_Full)],
+		TierCounts[static_cast<int32>(EAILODTier::EALT_Near)],
+		TierCounts[static_cast<int32>(EAILODTier::EALT_Far)],
+		TierCounts[static_cast<int32>(EAILODTier::EALT_Dormant)]);
+
+	BenchmarkFrameCount = 0;
+
+	// destroying unregisters them
+	TArray<AEnemy*> SpawnedEnemies = MoveTemp(BenchmarkEnemies);
+	for (AEnemy* Enemy : SpawnedEnemies)
+	{
+		if (Enemy)
+		{
+			Enemy->Destroy();
+		}
+	}
+}
+
+ETickableTickType UAILODSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UAILODSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAILODSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "AILODTier.h"
+#include "AILODSubsystem.generated.h"
+
+class AEnemy;
+class AEnemyController;
+
+struct FAILODEntry
+{
+	TWeakObjectPtr<AEnemy> Enemy;
+	EAILODTier Tier;
+
+	// the enemy stays at full rate for a while after damage or aggro
+	float PromoteTime;
+
+	// the mesh's own setting, restored at the near tiers
+	EVisibilityBasedAnimTickOption AnimTickOption;
+};
+
+/**
+ * Gives every enemy a think rate tier from its distance to the players, whether it was
+ * rendered and whether it is fighting. Far and unseen enemies tick their behavior tree,
+ * controller and actor less often, and skip animation while off screen.
+ * Tiers are re-evaluated a few enemies per frame.
+ */
+UCLASS()
+class SHOOTER_API UAILODSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	void RegisterEnemy(AEnemy* Enemy);
+	void UnregisterEnemy(AEnemy* Enemy);
+
+	// back to full rate right away, called on damage and aggro
+	void PromoteToFullRate(AEnemy* Enemy);
+
+	// the controller's blackboard got its first pending write, flushed at the end of the frame
+	void QueueBlackboardFlush(AEnemyController* Controller);
+
+	EAILODTier GetTier(const AEnemy* Enemy) const;
+
+	// spawns copies of the first enemy, then logs the game thread time with LOD off and on
+	void StartBenchmark(int32 EnemyCount, int32 FrameCount);
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return Entries.Num() > 0 || PendingBlackboardFlushes.Num() > 0; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+private:
+	EAILODTier EvaluateTier(const FAILODEntry& Entry, const TArray<FVector, TInlineAllocator<4>>& PlayerLocations) const;
+	void ApplyTier(FAILODEntry& Entry, EAILODTier Tier);
+	void RemoveEntry(int32 Index);
+
+	void UpdateBenchmark();
+	void FinishBenchmark();
+
+	TArray<FAILODEntry> Entries;
+
+	TArray<TWeakObjectPtr<AEnemyController>> PendingBlackboardFlushes;
+
+	int32 TierCounts[static_cast<int32>(EAILODTier::EALT_MAX)] = {};
+
+	// round robin over Entries
+	int32 NextEntry = 0;
+	float PendingEvaluations = 0.f;
+
+	// every enemy at full rate, for the benchmark
+	bool bForceFullRate = false;
+
+	UPROPERTY()
+	TArray<AEnemy*> BenchmarkEnemies;
+
+	int32 BenchmarkFrame = 0;
+	int32 BenchmarkFrameCount = 0;
+	double BenchmarkFullRateMs = 0.0;
+	double BenchmarkLODMs = 0.0;
+};
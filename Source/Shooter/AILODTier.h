@@ -0,0 +1,12 @@
+#pragma once
+
+UENUM(BlueprintType)
+enum class EAILODTier : uint8
+{
+	EALT_Full UMETA(DisplayName = "Full"),
+	EALT_Near UMETA(DisplayName = "Near"),
+	EALT_Far UMETA(DisplayName = "Far"),
+	EALT_Dormant UMETA(DisplayName = "Dormant"),
+
+	EALT_MAX UMETA(DisplayName = "DefaultMAX")
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AllocationTracker.h"
+#include "HAL/MemoryBase.h"
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Firing heap allocations"), STAT_FiringHeapAllocations, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Firing UObject allocations"), STAT_FiringObjectAllocations, STATGROUP_Shooter);
+
+FAllocationTracker& FAllocationTracker::Get()
+{
+	static FAllocationTracker Tracker;
+	return Tracker;
+}
+
+FAllocationTracker::FAllocationTracker() :
+	ScopeDepth(0),
+	ObjectsCreated(0),
+	HeapAllocations(0),
+	ObjectAllocations(0),
+	bListening(true)
+{
+	GUObjectArray.AddUObjectCreateListener(this);
+}
+
+bool FAllocationTracker::CanCountHeapAllocations()
+{
+#if UE_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64 FAllocationTracker::GetTotalMallocCalls()
+{
+#if UE_STATS
+	return FMalloc::TotalMallocCalls + FMalloc::TotalReallocCalls;
+#else
+	return 0;
+#endif
+}
+
+void FAllocationTracker::ResetTotals()
+{
+	HeapAllocations = 0;
+	ObjectAllocations = 0;
+}
+
+void FAllocationTracker::NotifyUObjectCreated(const UObjectBase* Object, int32 Index)
+{
+	if (ScopeDepth > 0 && IsInGameThread())
+	{
+		++ObjectsCreated;
+	}
+}
+
+void FAllocationTracker::OnUObjectArrayShutdown()
+{
+	if (bListening)
+	{
+		GUObjectArray.RemoveUObjectCreateListener(this);
+		bListening = false;
+	}
+}
+
+FAllocationTracker::FScope::FScope()
+{
+	FAllocationTracker& Tracker = FAllocationTracker::Get();
+	StartHeapAllocations = GetTotalMallocCalls();
+	StartObjectAllocations = Tracker.ObjectsCreated;
+	++Tracker.ScopeDepth;
+}
+
+FAllocationTracker::FScope::~FScope()
+{
+	FAllocationTracker& Tracker = FAllocationTracker::Get();
+	if (--Tracker.ScopeDepth > 0)
+	{
+		return;
+	}
+
+	const uint64 HeapDelta = GetTotalMallocCalls() - StartHeapAllocations;
+	const uint64 ObjectDelta = Tracker.ObjectsCreated - StartObjectAllocations;
+
+	Tracker.HeapAllocations += HeapDelta;
+	Tracker.ObjectAllocations += ObjectDelta;
+
+	INC_DWORD_STAT_BY(STAT_FiringHeapAllocations, HeapDelta);
+	INC_DWORD_STAT_BY(STAT_FiringObjectAllocations, ObjectDelta);
+}
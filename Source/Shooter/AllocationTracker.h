@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/UObjectArray.h"
+
+/**
+ * Counts heap and UObject allocations made on the game thread inside FScope,
+ * used to keep the firing and reload paths allocation free.
+ * Heap counts need stats (UE_STATS) and include anything other threads allocate while a scope is open.
+ */
+class SHOOTER_API FAllocationTracker : public FUObjectArray::FUObjectCreateListener
+{
+public:
+	static FAllocationTracker& Get();
+
+	// nested scopes count once
+	struct SHOOTER_API FScope
+	{
+		FScope();
+		~FScope();
+
+	private:
+		uint64 StartHeapAllocations;
+		uint64 StartObjectAllocations;
+	};
+
+	// false without stats, heap allocations always read 0 then
+	static bool CanCountHeapAllocations();
+
+	FORCEINLINE uint64 GetHeapAllocations() const { return HeapAllocations; }
+	FORCEINLINE uint64 GetObjectAllocations() const { return ObjectAllocations; }
+
+	void ResetTotals();
+
+	// FUObjectCreateListener
+	virtual void NotifyUObjectCreated(const class UObjectBase* Object, int32 Index) override;
+	virtual void OnUObjectArrayShutdown() override;
+
+private:
+	FAllocationTracker();
+
+	static uint64 GetTotalMallocCalls();
+
+	int32 ScopeDepth;
+	uint64 ObjectsCreated;
+
+	// totals inside scopes since the last reset
+	uint64 HeapAllocations;
+	uint64 ObjectAllocations;
+
+	bool bListening;
+};
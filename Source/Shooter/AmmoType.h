@@ -5,6 +5,7 @@ enum class EAmmoType : uint8
 {
 	EAT_9mm UMETA(FEnumDisplayName = "9mm"),
 	EAT_AR UMETA(FEnumDisplayName = "Assoult Rifle"),
+	EAT_Shells UMETA(FEnumDisplayName = "Shells"),
 
 	EAT_MAX UMETA(FEnumDisplayName = "Deffaults Rifle")
 };
\ No newline at end of file
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AnimNotifyState_MeleeSweep.h"
+#include "Enemy.h"
+
+void UAnimNotifyState_MeleeSweep::NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float TotalDuration)
+{
+	Super::NotifyBegin(MeshComp, Animation, TotalDuration);
+
+	AEnemy* Enemy = MeshComp ? Cast<AEnemy>(MeshComp->GetOwner()) : nullptr;
+	if (Enemy)
+	{
+		Enemy->BeginMeleeSweep(bLeftWeapon);
+	}
+}
+
+void UAnimNotifyState_MeleeSweep::NotifyTick(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float FrameDeltaTime)
+{
+	Super::NotifyTick(MeshComp, Animation, FrameDeltaTime);
+
+	AEnemy* Enemy = MeshComp ? Cast<AEnemy>(MeshComp->GetOwner()) : nullptr;
+	if (Enemy)
+	{
+		Enemy->UpdateMeleeSweep(bLeftWeapon);
+	}
+}
+
+void UAnimNotifyState_MeleeSweep::NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation)
+{
+	Super::NotifyEnd(MeshComp, Animation);
+
+	AEnemy* Enemy = MeshComp ? Cast<AEnemy>(MeshComp->GetOwner()) : nullptr;
+	if (Enemy)
+	{
+		// the last frame of the window still counts
+		Enemy->UpdateMeleeSweep(bLeftWeapon);
+		Enemy->EndMeleeSweep(bLeftWeapon);
+	}
+}
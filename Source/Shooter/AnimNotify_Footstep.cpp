@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AnimNotify_Footstep.h"
+#include "FootstepComponent.h"
+
+void UAnimNotify_Footstep::Notify(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation)
+{
+	Super::Notify(MeshComp, Animation);
+
+	AActor* Owner = MeshComp ? MeshComp->GetOwner() : nullptr;
+	UFootstepComponent* Footsteps = Owner ? Owner->FindComponentByClass<UFootstepComponent>() : nullptr;
+	if (Footsteps)
+	{
+		Footsteps->PlayFootstep();
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+UENUM(BlueprintType)
+enum class EAudioEventCategory : uint8
+{
+	EAEC_WeaponFire UMETA(DisplayName = "Weapon Fire"),
+	EAEC_Impact UMETA(DisplayName = "Impact"),
+	EAEC_Melee UMETA(DisplayName = "Melee"),
+	EAEC_Explosion UMETA(DisplayName = "Explosion"),
+	EAEC_Pickup UMETA(DisplayName = "Pickup"),
+	EAEC_Equip UMETA(DisplayName = "Equip"),
+	EAEC_Footstep UMETA(DisplayName = "Footstep"),
+
+	EAEC_MAX UMETA(DisplayName = "DefaultMAX")
+};
@@ -0,0 +1,346 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AudioEventSubsystem.h"
+#include "Components/AudioComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Sound/SoundBase.h"
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio events requested"), STAT_AudioEventsRequested, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio events culled"), STAT_AudioEventsCulled, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio events played"), STAT_AudioEventsPlayed, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio voices"), STAT_AudioVoices, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarAudioPoolSize(
+	TEXT("shooter.AudioPoolSize"),
+	32,
+	TEXT("Most pooled audio components, events are dropped when all of them are playing or reserved by another category."),
+	ECVF_Default);
+
+void UAudioEventSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	for (int32 Index = 0; Index < static_cast<int32>(EAudioEventCategory::EAEC_MAX); ++Index)
+	{
+		LastEventTimes[Index] = -BIG_NUMBER;
+		CategoryVoices[Index] = 0;
+	}
+
+	// a shot always gets a voice, its voices are held back from the other categories
+	// and past them it takes over its own oldest one
+	FAudioCategoryRules& WeaponFire = GetCategoryRules(EAudioEventCategory::EAEC_WeaponFire);
+	WeaponFire.MaxVoices = 8;
+	WeaponFire.bStealOldest = true;
+	WeaponFire.ReservedVoices = 8;
+
+	FAudioCategoryRules& Impact = GetCategoryRules(EAudioEventCategory::EAEC_Impact);
+	Impact.MaxVoices = 6;
+	Impact.MinInterval = 0.03f;
+	Impact.MaxDistance = 4000.f;
+
+	FAudioCategoryRules& Melee = GetCategoryRules(EAudioEventCategory::EAEC_Melee);
+	Melee.MaxVoices = 4;
+	Melee.MaxDistance = 3000.f;
+
+	FAudioCategoryRules& Explosion = GetCategoryRules(EAudioEventCategory::EAEC_Explosion);
+	Explosion.MaxVoices = 4;
+	Explosion.bStealOldest = true;
+
+	FAudioCategoryRules& Pickup = GetCategoryRules(EAudioEventCategory::EAEC_Pickup);
+	Pickup.MaxVoices = 2;
+	Pickup.MinInterval = 0.2f;
+
+	FAudioCategoryRules& Equip = GetCategoryRules(EAudioEventCategory::EAEC_Equip);
+	Equip.MaxVoices = 2;
+	Equip.MinInterval = 0.2f;
+
+	FAudioCategoryRules& Footstep = GetCategoryRules(EAudioEventCategory::EAEC_Footstep);
+	Footstep.MaxVoices = 6;
+	Footstep.MaxDistance = 2500.f;
+}
+
+void UAudioEventSubsystem::Deinitialize()
+{
+	for (UAudioComponent* Component : Components)
+	{
+		if (Component)
+		{
+			Component->DestroyComponent();
+		}
+	}
+
+	Components.Reset();
+	VoiceCategories.Reset();
+	VoiceStartTimes.Reset();
+	VoiceSerials.Reset();
+	VoiceLooping.Reset();
+	FreeVoices.Reset();
+	ActiveCount = 0;
+
+	Super::Deinitialize();
+}
+
+bool UAudioEventSubsystem::PlaySound2D(EAudioEventCategory Category, USoundBase* Sound, bool bIgnoreRateLimit)
+{
+	return PlayEvent(Category, Sound, nullptr, bIgnoreRateLimit);
+}
+
+bool UAudioEventSubsystem::PlaySoundAtLocation(EAudioEventCategory Category, USoundBase* Sound, const FVector& Location)
+{
+	return PlayEvent(Category, Sound, &Location, false);
+}
+
+bool UAudioEventSubsystem::PlaySound2D(const UObject* WorldContextObject, EAudioEventCategory Category, USoundBase* Sound, bool bIgnoreRateLimit)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UAudioEventSubsystem* AudioEvents = World ? World->GetSubsystem<UAudioEventSubsystem>() : nullptr;
+	return AudioEvents && AudioEvents->PlaySound2D(Category, Sound, bIgnoreRateLimit);
+}
+
+bool UAudioEventSubsystem::PlaySoundAtLocation(const UObject* WorldContextObject, EAudioEventCategory Category, USoundBase* Sound, const FVector& Location)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UAudioEventSubsystem* AudioEvents = World ? World->GetSubsystem<UAudioEventSubsystem>() : nullptr;
+	return AudioEvents && AudioEvents->PlaySoundAtLocation(Category, Sound, Location);
+}
+
+bool UAudioEventSubsystem::PlayEvent(EAudioEventCategory Category, USoundBase* Sound, const FVector* Location, bool bIgnoreRateLimit)
+{
+	if (Sound == nullptr || GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_AudioEventsRequested);
+
+	const int32 CategoryIndex = static_cast<int32>(Category);
+	const FAudioCategoryRules& Rules = CategoryRules[CategoryIndex];
+	const float Time = GetWorld()->GetTimeSeconds();
+
+	// rate limit, replaces the old per character pickup and equip sound timers
+	if (!bIgnoreRateLimit && Time - LastEventTimes[CategoryIndex] < Rules.MinInterval)
+	{
+		INC_DWORD_STAT(STAT_AudioEventsCulled);
+		return false;
+	}
+
+	if (Location && IsOutOfRange(Rules, Sound, *Location))
+	{
+		INC_DWORD_STAT(STAT_AudioEventsCulled);
+		return false;
+	}
+
+	const int32 VoiceIndex = AcquireVoice(Category, Rules);
+	if (VoiceIndex == INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_AudioEventsCulled);
+		return false;
+	}
+
+	LastEventTimes[CategoryIndex] = Time;
+	VoiceStartTimes[VoiceIndex] = Time;
+
+	UAudioComponent* Component = Components[VoiceIndex];
+	Component->SetSound(Sound);
+	Component->SetPitchMultiplier(1.f);
+	Component->bAllowSpatialization = Location != nullptr;
+	if (Location)
+	{
+		Component->SetWorldLocation(*Location);
+	}
+	Component->Play();
+
+	INC_DWORD_STAT(STAT_AudioEventsPlayed);
+	return true;
+}
+
+FAudioLoopHandle UAudioEventSubsystem::PlayLoop2D(EAudioEventCategory Category, USoundBase* Sound, float PitchMultiplier)
+{
+	FAudioLoopHandle Handle;
+	if (Sound == nullptr || GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return Handle;
+	}
+
+	INC_DWORD_STAT(STAT_AudioEventsRequested);
+
+	const int32 VoiceIndex = AcquireVoice(Category, CategoryRules[static_cast<int32>(Category)]);
+	if (VoiceIndex == INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_AudioEventsCulled);
+		return Handle;
+	}
+
+	const float Time = GetWorld()->GetTimeSeconds();
+	LastEventTimes[static_cast<int32>(Category)] = Time;
+	VoiceStartTimes[VoiceIndex] = Time;
+	VoiceLooping[VoiceIndex] = true;
+
+	UAudioComponent* Component = Components[VoiceIndex];
+	Component->SetSound(Sound);
+	Component->SetPitchMultiplier(PitchMultiplier);
+	Component->bAllowSpatialization = false;
+	Component->Play();
+
+	INC_DWORD_STAT(STAT_AudioEventsPlayed);
+	Handle.VoiceIndex = VoiceIndex;
+	Handle.Serial = VoiceSerials[VoiceIndex];
+	return Handle;
+}
+
+void UAudioEventSubsystem::StopLoop(FAudioLoopHandle& Handle, float FadeOutDuration)
+{
+	if (Handle.IsValid() && VoiceSerials.IsValidIndex(Handle.VoiceIndex) && VoiceSerials[Handle.VoiceIndex] == Handle.Serial
+		&& VoiceLooping[Handle.VoiceIndex])
+	{
+		// the voice goes back to the pool in Tick once the fade is done
+		VoiceLooping[Handle.VoiceIndex] = false;
+		if (UAudioComponent* Component = Components[Handle.VoiceIndex])
+		{
+			if (FadeOutDuration > 0.f)
+			{
+				Component->FadeOut(FadeOutDuration, 0.f);
+			}
+			else
+			{
+				Component->Stop();
+			}
+		}
+	}
+
+	Handle = FAudioLoopHandle();
+}
+
+bool UAudioEventSubsystem::IsOutOfRange(const FAudioCategoryRules& Rules, USoundBase* Sound, const FVector& Location) const
+{
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController == nullptr)
+	{
+		return false;
+	}
+
+	FVector ListenerLocation;
+	FVector ListenerFront;
+	FVector ListenerRight;
+	PlayerController->GetAudioListenerPosition(ListenerLocation, ListenerFront, ListenerRight);
+
+	float MaxDistance = Sound->GetMaxDistance();
+	if (Rules.MaxDistance > 0.f)
+	{
+		MaxDistance = FMath::Min(MaxDistance, Rules.MaxDistance);
+	}
+
+	return FVector::DistSquared(ListenerLocation, Location) > FMath::Square(MaxDistance);
+}
+
+int32 UAudioEventSubsystem::AcquireVoice(EAudioEventCategory Category, const FAudioCategoryRules& Rules)
+{
+	const int32 CategoryIndex = static_cast<int32>(Category);
+
+	if (CategoryVoices[CategoryIndex] >= Rules.MaxVoices)
+	{
+		return Rules.bStealOldest ? StealOldestVoice(Category) : INDEX_NONE;
+	}
+
+	// voices other categories have reserved and aren't using yet
+	int32 ReservedByOthers = 0;
+	for (int32 Index = 0; Index < static_cast<int32>(EAudioEventCategory::EAEC_MAX); ++Index)
+	{
+		if (Index != CategoryIndex)
+		{
+			ReservedByOthers += FMath::Max(CategoryRules[Index].ReservedVoices - CategoryVoices[Index], 0);
+		}
+	}
+
+	const int32 PoolSize = FMath::Max(CVarAudioPoolSize.GetValueOnGameThread(), Components.Num());
+	int32 VoiceIndex = INDEX_NONE;
+	if (ActiveCount + ReservedByOthers >= PoolSize)
+	{
+		return Rules.bStealOldest ? StealOldestVoice(Category) : INDEX_NONE;
+	}
+	else if (FreeVoices.Num() > 0)
+	{
+		VoiceIndex = FreeVoices.Pop(false);
+	}
+	else if (Components.Num() < PoolSize)
+	{
+		UWorld* World = GetWorld();
+		UAudioComponent* Component = NewObject<UAudioComponent>(World);
+		Component->bAutoActivate = false;
+		Component->bAutoDestroy = false;
+		Component->SetAbsolute(true, true, true);
+		Component->RegisterComponentWithWorld(World);
+
+		VoiceIndex = Components.Add(Component);
+		VoiceCategories.Add(EAudioEventCategory::EAEC_MAX);
+		VoiceStartTimes.Add(0.f);
+		VoiceSerials.Add(0);
+		VoiceLooping.Add(false);
+	}
+	else
+	{
+		return Rules.bStealOldest ? StealOldestVoice(Category) : INDEX_NONE;
+	}
+
+	VoiceCategories[VoiceIndex] = Category;
+	++VoiceSerials[VoiceIndex];
+	++CategoryVoices[CategoryIndex];
+	++ActiveCount;
+	return VoiceIndex;
+}
+
+int32 UAudioEventSubsystem::StealOldestVoice(EAudioEventCategory Category)
+{
+	// the voice keeps its category, only the sound changes, loops stay with their owner
+	int32 OldestIndex = INDEX_NONE;
+	for (int32 Index = 0; Index < VoiceCategories.Num(); ++Index)
+	{
+		if (VoiceCategories[Index] == Category && !VoiceLooping[Index] && (OldestIndex == INDEX_NONE || VoiceStartTimes[Index] < VoiceStartTimes[OldestIndex]))
+		{
+			OldestIndex = Index;
+		}
+	}
+
+	if (OldestIndex != INDEX_NONE)
+	{
+		Components[OldestIndex]->Stop();
+		++VoiceSerials[OldestIndex];
+	}
+	return OldestIndex;
+}
+
+void UAudioEventSubsystem::ReleaseVoice(int32 VoiceIndex)
+{
+	--CategoryVoices[static_cast<int32>(VoiceCategories[VoiceIndex])];
+	--ActiveCount;
+
+	VoiceCategories[VoiceIndex] = EAudioEventCategory::EAEC_MAX;
+	VoiceLooping[VoiceIndex] = false;
+	FreeVoices.Add(VoiceIndex);
+}
+
+void UAudioEventSubsystem::Tick(float DeltaTime)
+{
+	// finished voices go back to the pool
+	for (int32 Index = 0; Index < Components.Num(); ++Index)
+	{
+		if (VoiceCategories[Index] != EAudioEventCategory::EAEC_MAX && (Components[Index] == nullptr || !Components[Index]->IsPlaying()))
+		{
+			ReleaseVoice(Index);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_AudioVoices, ActiveCount);
+}
+
+ETickableTickType UAudioEventSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UAudioEventSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAudioEventSubsystem, STATGROUP_Tickables);
+}
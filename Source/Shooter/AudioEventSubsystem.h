@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "AudioEventCategory.h"
+#include "AudioEventSubsystem.generated.h"
+
+class USoundBase;
+class UAudioComponent;
+
+USTRUCT(BlueprintType)
+struct FAudioCategoryRules
+{
+	GENERATED_BODY()
+
+	// voices of the category playing at once
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 MaxVoices = 8;
+
+	// at the voice limit the oldest voice is stopped, otherwise the new event is dropped
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bStealOldest = false;
+
+	// voices of the pool other categories can't take while this one isn't using them
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 ReservedVoices = 0;
+
+	// seconds between two events of the category
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MinInterval = 0.f;
+
+	// events further from the listener are dropped, 0 uses only the sound's attenuation
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MaxDistance = 0.f;
+};
+
+// a looping voice, goes stale once the voice is stopped and reused
+struct FAudioLoopHandle
+{
+	int32 VoiceIndex = INDEX_NONE;
+	uint32 Serial = 0;
+
+	FORCEINLINE bool IsValid() const { return VoiceIndex != INDEX_NONE; }
+};
+
+/**
+ * Plays gameplay sounds on pooled audio components. Every category has a voice limit,
+ * a rate limit and a distance limit, so bursts of shots and hits can't flood the mixer.
+ */
+UCLASS()
+class SHOOTER_API UAudioEventSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// false when the event was culled
+	bool PlaySound2D(EAudioEventCategory Category, USoundBase* Sound, bool bIgnoreRateLimit = false);
+	bool PlaySoundAtLocation(EAudioEventCategory Category, USoundBase* Sound, const FVector& Location);
+
+	// shorthand for the subsystem of the context object's world
+	static bool PlaySound2D(const UObject* WorldContextObject, EAudioEventCategory Category, USoundBase* Sound, bool bIgnoreRateLimit = false);
+	static bool PlaySoundAtLocation(const UObject* WorldContextObject, EAudioEventCategory Category, USoundBase* Sound, const FVector& Location);
+
+	// a loop holds its voice until StopLoop, it is never stolen, invalid handle when culled
+	FAudioLoopHandle PlayLoop2D(EAudioEventCategory Category, USoundBase* Sound, float PitchMultiplier = 1.f);
+	void StopLoop(FAudioLoopHandle& Handle, float FadeOutDuration = 0.f);
+
+	FORCEINLINE FAudioCategoryRules& GetCategoryRules(EAudioEventCategory Category) { return CategoryRules[static_cast<int32>(Category)]; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return ActiveCount > 0; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+private:
+	bool PlayEvent(EAudioEventCategory Category, USoundBase* Sound, const FVector* Location, bool bIgnoreRateLimit);
+	bool IsOutOfRange(const FAudioCategoryRules& Rules, USoundBase* Sound, const FVector& Location) const;
+	int32 AcquireVoice(EAudioEventCategory Category, const FAudioCategoryRules& Rules);
+	int32 StealOldestVoice(EAudioEventCategory Category);
+	void ReleaseVoice(int32 VoiceIndex);
+
+	FAudioCategoryRules CategoryRules[static_cast<int32>(EAudioEventCategory::EAEC_MAX)];
+	float LastEventTimes[static_cast<int32>(EAudioEventCategory::EAEC_MAX)];
+	int32 CategoryVoices[static_cast<int32>(EAudioEventCategory::EAEC_MAX)];
+
+	UPROPERTY()
+	TArray<UAudioComponent*> Components;
+
+	// category of each component's voice, EAEC_MAX when free
+	TArray<EAudioEventCategory> VoiceCategories;
+	TArray<float> VoiceStartTimes;
+	// bumped every time a voice is acquired, so stale loop handles can't stop the next sound
+	TArray<uint32> VoiceSerials;
+	TArray<bool> VoiceLooping;
+	TArray<int32> FreeVoices;
+
+	int32 ActiveCount = 0;
+};
@@ -0,0 +1,280 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallisticsSubsystem.h"
+#include "ShooterCharacter.h"
+#include "Weapon.h"
+#include "TracerSubsystem.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ballistics Tick"), STAT_BallisticsTick, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Ballistics Step"), STAT_BallisticsStep, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bullets in flight"), STAT_BulletsInFlight, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ballistic segment traces"), STAT_BallisticSegmentTraces, STATGROUP_Shooter);
+
+static FAutoConsoleCommand BallisticsBenchmarkCommand(
+	TEXT("shooter.BallisticsBenchmark"),
+	TEXT("Steps bullets without a world and logs ns per bullet per step.\n")
+	TEXT("shooter.BallisticsBenchmark [BulletCount=5000] [StepCount=1000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 BulletCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 5000;
+		const int32 StepCount = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1000;
+		UBallisticsSubsystem::RunBenchmark(BulletCount, StepCount);
+	}));
+
+void FBallisticsSimulation::Reserve(int32 Count)
+{
+	PositionX.Reserve(Count);
+	PositionY.Reserve(Count);
+	PositionZ.Reserve(Count);
+	VelocityX.Reserve(Count);
+	VelocityY.Reserve(Count);
+	VelocityZ.Reserve(Count);
+	PreviousX.Reserve(Count);
+	PreviousY.Reserve(Count);
+	PreviousZ.Reserve(Count);
+	Age.Reserve(Count);
+	Info.Reserve(Count);
+}
+
+void FBallisticsSimulation::Add(const FVector& Location, const FVector& Velocity, const FBallisticBulletInfo& BulletInfo)
+{
+	PositionX.Add(Location.X);
+	PositionY.Add(Location.Y);
+	PositionZ.Add(Location.Z);
+	VelocityX.Add(Velocity.X);
+	VelocityY.Add(Velocity.Y);
+	VelocityZ.Add(Velocity.Z);
+	PreviousX.Add(Location.X);
+	PreviousY.Add(Location.Y);
+	PreviousZ.Add(Location.Z);
+	Age.Add(0.f);
+	Info.Add(BulletInfo);
+}
+
+void FBallisticsSimulation::Step(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BallisticsStep);
+
+	const int32 Count = Num();
+	const int32 VectorCount = Count & ~3;
+
+	// semi implicit euler - gravity first, then move with the new velocity
+	const VectorRegister VDeltaTime = VectorSetFloat1(DeltaTime);
+	const VectorRegister VGravityStep = VectorSetFloat1(GravityZ * DeltaTime);
+
+	for (int32 Index = 0; Index < VectorCount; Index += 4)
+	{
+		const VectorRegister VelX = VectorLoad(&VelocityX[Index]);
+		const VectorRegister VelY = VectorLoad(&VelocityY[Index]);
+		const VectorRegister VelZ = VectorAdd(VectorLoad(&VelocityZ[Index]), VGravityStep);
+		VectorStore(VelZ, &VelocityZ[Index]);
+
+		const VectorRegister PosX = VectorLoad(&PositionX[Index]);
+		const VectorRegister PosY = VectorLoad(&PositionY[Index]);
+		const VectorRegister PosZ = VectorLoad(&PositionZ[Index]);
+		VectorStore(PosX, &PreviousX[Index]);
+		VectorStore(PosY, &PreviousY[Index]);
+		VectorStore(PosZ, &PreviousZ[Index]);
+
+		VectorStore(VectorMultiplyAdd(VelX, VDeltaTime, PosX), &PositionX[Index]);
+		VectorStore(VectorMultiplyAdd(VelY, VDeltaTime, PosY), &PositionY[Index]);
+		VectorStore(VectorMultiplyAdd(VelZ, VDeltaTime, PosZ), &PositionZ[Index]);
+
+		VectorStore(VectorAdd(VectorLoad(&Age[Index]), VDeltaTime), &Age[Index]);
+	}
+
+	// last 0-3 bullets
+	for (int32 Index = VectorCount; Index < Count; ++Index)
+	{
+		VelocityZ[Index] += GravityZ * DeltaTime;
+
+		PreviousX[Index] = PositionX[Index];
+		PreviousY[Index] = PositionY[Index];
+		PreviousZ[Index] = PositionZ[Index];
+
+		PositionX[Index] += VelocityX[Index] * DeltaTime;
+		PositionY[Index] += VelocityY[Index] * DeltaTime;
+		PositionZ[Index] += VelocityZ[Index] * DeltaTime;
+
+		Age[Index] += DeltaTime;
+	}
+}
+
+void FBallisticsSimulation::RemoveExpired()
+{
+	// going backwards, the bullet swapped in from the end was already checked
+	for (int32 Index = Num() - 1; Index >= 0; --Index)
+	{
+		if (IsExpired(Index))
+		{
+			RemoveAtSwap(Index);
+		}
+	}
+}
+
+void FBallisticsSimulation::RemoveAtSwap(int32 Index)
+{
+	PositionX.RemoveAtSwap(Index, 1, false);
+	PositionY.RemoveAtSwap(Index, 1, false);
+	PositionZ.RemoveAtSwap(Index, 1, false);
+	VelocityX.RemoveAtSwap(Index, 1, false);
+	VelocityY.RemoveAtSwap(Index, 1, false);
+	VelocityZ.RemoveAtSwap(Index, 1, false);
+	PreviousX.RemoveAtSwap(Index, 1, false);
+	PreviousY.RemoveAtSwap(Index, 1, false);
+	PreviousZ.RemoveAtSwap(Index, 1, false);
+	Age.RemoveAtSwap(Index, 1, false);
+	Info.RemoveAtSwap(Index, 1, false);
+}
+
+void UBallisticsSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	SegmentTraceDelegate.BindUObject(this, &UBallisticsSubsystem::OnSegmentTraceCompleted);
+	SegmentQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(BallisticSegmentTrace), false);
+	SegmentQueryParams.bReturnPhysicalMaterial = true;
+	Simulation.Reserve(256);
+}
+
+void UBallisticsSubsystem::FireBullet(AShooterCharacter* Shooter, AWeapon* Weapon, const FVector& MuzzleLocation, const FVector& Velocity)
+{
+	Simulation.Add(MuzzleLocation, Velocity, FBallisticBulletInfo{ Shooter, Weapon, MuzzleLocation });
+}
+
+void UBallisticsSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BallisticsTick);
+
+	// hits came back for the segments queued last frame, bullet indices are still the same
+	ApplyHits();
+	Simulation.RemoveExpired();
+
+	Simulation.GravityZ = GetWorld()->GetGravityZ();
+	Simulation.Step(DeltaTime);
+
+	QueueSegmentTraces();
+	AddTracerStreaks();
+
+	SET_DWORD_STAT(STAT_BulletsInFlight, Simulation.Num());
+}
+
+bool UBallisticsSubsystem::IsTickable() const
+{
+	return Simulation.Num() > 0 || PendingHits.Num() > 0;
+}
+
+ETickableTickType UBallisticsSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UBallisticsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBallisticsSubsystem, STATGROUP_Tickables);
+}
+
+void UBallisticsSubsystem::QueueSegmentTraces()
+{
+	UWorld* World = GetWorld();
+	const int32 Count = Simulation.Num();
+	SegmentTraceTime = World->GetTimeSeconds();
+
+	// one segment per bullet, all of them go out in the same async batch
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		if (Simulation.IsExpired(Index))
+		{
+			continue;
+		}
+
+		World->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+			Simulation.GetPrevious(Index),
+			Simulation.GetPosition(Index),
+			ECC_Weapon,
+			SegmentQueryParams,
+			FCollisionResponseParams::DefaultResponseParam,
+			&SegmentTraceDelegate,
+			static_cast<uint32>(Index));
+	}
+
+	INC_DWORD_STAT_BY(STAT_BallisticSegmentTraces, Count);
+}
+
+void UBallisticsSubsystem::AddTracerStreaks()
+{
+	UTracerSubsystem* Tracers = GetWorld()->GetSubsystem<UTracerSubsystem>();
+	if (Tracers == nullptr || !Tracers->HasTracerMesh())
+	{
+		return;
+	}
+
+	for (int32 Index = 0; Index < Simulation.Num(); ++Index)
+	{
+		if (!Simulation.IsExpired(Index))
+		{
+			Tracers->AddFrameStreak(Simulation.GetPrevious(Index), Simulation.GetPosition(Index));
+		}
+	}
+}
+
+void UBallisticsSubsystem::OnSegmentTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	if (TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit)
+	{
+		PendingHits.Add(FBallisticHit{ static_cast<int32>(TraceDatum.UserData), TraceDatum.OutHits[0], SegmentTraceTime });
+	}
+}
+
+void UBallisticsSubsystem::ApplyHits()
+{
+	for (const FBallisticHit& Hit : PendingHits)
+	{
+		// new bullets are only ever appended, so the index still points at the bullet that was traced
+		if (!Simulation.Info.IsValidIndex(Hit.BulletIndex))
+		{
+			continue;
+		}
+
+		const FBallisticBulletInfo& BulletInfo = Simulation.Info[Hit.BulletIndex];
+		AShooterCharacter* Shooter = BulletInfo.Shooter.Get();
+		if (Shooter)
+		{
+			Shooter->ApplyBallisticHit(BulletInfo.Weapon.Get(), BulletInfo.MuzzleLocation, Hit.HitResult, Hit.TraceTime);
+		}
+
+		Simulation.Kill(Hit.BulletIndex);
+	}
+
+	PendingHits.Reset();
+}
+
+void UBallisticsSubsystem::RunBenchmark(int32 BulletCount, int32 StepCount)
+{
+	BulletCount = FMath::Max(BulletCount, 1);
+	StepCount = FMath::Max(StepCount, 1);
+
+	FBallisticsSimulation BenchmarkSimulation;
+	// bullets never expire during the benchmark
+	BenchmarkSimulation.MaxLifetime = BIG_NUMBER;
+	BenchmarkSimulation.Reserve(BulletCount);
+
+	FRandomStream RandomStream(BulletCount);
+	for (int32 Index = 0; Index < BulletCount; ++Index)
+	{
+		BenchmarkSimulation.Add(RandomStream.GetUnitVector() * 1000.f, RandomStream.GetUnitVector() * 30000.f, FBallisticBulletInfo{ nullptr, nullptr, FVector::ZeroVector });
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Step = 0; Step < StepCount; ++Step)
+	{
+		BenchmarkSimulation.Step(1.f / 60.f);
+	}
+	const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+
+	const double NanosecondsPerBulletStep = ElapsedSeconds * 1.0e9 / (static_cast<double>(BulletCount) * StepCount);
+	UE_LOG(LogTemp, Log, TEXT("Ballistics benchmark: %d bullets, %d steps, %.3f ms total, %.3f ns per bullet per step"),
+		BulletCount, StepCount, ElapsedSeconds * 1000.0, NanosecondsPerBulletStep);
+}
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+#include "BallisticsSubsystem.generated.h"
+
+// per bullet data only needed when the bullet hits something
+struct FBallisticBulletInfo
+{
+	TWeakObjectPtr<class AShooterCharacter> Shooter;
+	TWeakObjectPtr<class AWeapon> Weapon;
+	FVector MuzzleLocation;
+};
+
+/**
+ * Bullets in flight as structure of arrays, stepped 4 at a time.
+ * Plain struct so it can be stepped without a world (benchmark).
+ */
+struct FBallisticsSimulation
+{
+	TArray<float> PositionX;
+	TArray<float> PositionY;
+	TArray<float> PositionZ;
+
+	TArray<float> VelocityX;
+	TArray<float> VelocityY;
+	TArray<float> VelocityZ;
+
+	// position before the last step, start of the segment trace
+	TArray<float> PreviousX;
+	TArray<float> PreviousY;
+	TArray<float> PreviousZ;
+
+	TArray<float> Age;
+
+	TArray<FBallisticBulletInfo> Info;
+
+	float GravityZ = -980.f;
+	float MaxLifetime = 3.f;
+
+	FORCEINLINE int32 Num() const { return Age.Num(); }
+	FORCEINLINE FVector GetPosition(int32 Index) const { return FVector(PositionX[Index], PositionY[Index], PositionZ[Index]); }
+	FORCEINLINE FVector GetPrevious(int32 Index) const { return FVector(PreviousX[Index], PreviousY[Index], PreviousZ[Index]); }
+	FORCEINLINE bool IsExpired(int32 Index) const { return Age[Index] >= MaxLifetime; }
+	FORCEINLINE void Kill(int32 Index) { Age[Index] = MaxLifetime; }
+
+	void Reserve(int32 Count);
+	void Add(const FVector& Location, const FVector& Velocity, const FBallisticBulletInfo& BulletInfo);
+
+	// integrates velocity and position of every bullet
+	void Step(float DeltaTime);
+
+	// removes expired and killed bullets, order is not kept
+	void RemoveExpired();
+
+private:
+	void RemoveAtSwap(int32 Index);
+};
+
+/**
+ * Owns every ballistic bullet in the world. Each frame applies the hits that came back,
+ * steps all bullets and queues one async segment trace per bullet.
+ */
+UCLASS()
+class SHOOTER_API UBallisticsSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	void FireBullet(AShooterCharacter* Shooter, AWeapon* Weapon, const FVector& MuzzleLocation, const FVector& Velocity);
+
+	FORCEINLINE int32 GetBulletsInFlight() const { return Simulation.Num(); }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+	// steps BulletCount bullets StepCount times without a world and logs ns per bullet per step
+	static void RunBenchmark(int32 BulletCount, int32 StepCount);
+
+private:
+	void OnSegmentTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+	void ApplyHits();
+	void QueueSegmentTraces();
+
+	// a tracer streak along the last segment of every bullet in flight
+	void AddTracerStreaks();
+
+	FBallisticsSimulation Simulation;
+
+	// hit bullet index -> hit, filled by the trace callbacks before the next step
+	struct FBallisticHit
+	{
+		int32 BulletIndex;
+		FHitResult HitResult;
+		// when the segment was traced, hits are validated against the targets at this time
+		float TraceTime;
+	};
+	TArray<FBallisticHit> PendingHits;
+
+	// world time the segments in flight were queued at
+	float SegmentTraceTime = 0.f;
+
+	FTraceDelegate SegmentTraceDelegate;
+
+	// physical material is needed for surface impacts
+	FCollisionQueryParams SegmentQueryParams;
+};
@@ -4,3 +4,9 @@
 #include "BulletHitInterface.h"
 
 // Add default functionality here for any IBulletHitInterface functions that are not pure virtual.
+
+void IBulletHitInterface::BulletHitBatch(const FBulletHitBatch& Batch)
+{
+	// blueprint only receivers still get the single hit event
+	Execute_BulletHit(_getUObject(), Batch.GetFirstHit(), Batch.Shooter, Batch.ShooterController);
+}
@@ -6,6 +6,31 @@
 #include "UObject/Interface.h"
 #include "BulletHitInterface.generated.h"
 
+// one hit waiting for combat resolution
+struct FBulletHitEntry
+{
+	FHitResult HitResult;
+	TWeakObjectPtr<AActor> Target;
+	TWeakObjectPtr<AActor> Shooter;
+	TWeakObjectPtr<AController> ShooterController;
+	float Damage;
+	bool bHeadShot;
+	// false for splash damage, the target only takes the damage
+	bool bBulletHit;
+};
+
+// every bullet hit one receiver took from one shooter this frame
+struct FBulletHitBatch
+{
+	TArrayView<const FBulletHitEntry> Hits;
+	AActor* Shooter;
+	AController* ShooterController;
+	float TotalDamage;
+	bool bHeadShot;
+
+	FORCEINLINE const FHitResult& GetFirstHit() const { return Hits[0].HitResult; }
+};
+
 // This class does not need to be modified.
 UINTERFACE(MinimalAPI)
 class UBulletHitInterface : public UInterface
@@ -24,5 +49,8 @@ class SHOOTER_API IBulletHitInterface
 public:
 
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable)
-	void BulletHit(FHitResult HitResult, AActor* Shooter, AController* ShooterContorller);
+	void BulletHit(const FHitResult& HitResult, AActor* Shooter, AController* ShooterContorller);
+
+	// called once per frame by the combat resolution with all hits from one shooter, defaults to BulletHit for the first hit
+	virtual void BulletHitBatch(const FBulletHitBatch& Batch);
 };
@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatResolutionSubsystem.h"
+#include "Enemy.h"
+#include "Kismet/GameplayStatics.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Combat Resolution"), STAT_CombatResolution, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued hits"), STAT_QueuedHits, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Resolved targets"), STAT_ResolvedTargets, STATGROUP_Shooter);
+
+// explosions setting off explosions are resolved on the same frame, up to this many rounds
+static constexpr int32 MaxResolveRounds = 8;
+
+void UCombatResolutionSubsystem::QueueBulletHit(const FHitResult& HitResult, float Damage, bool bHeadShot, AActor* Shooter, AController* ShooterController)
+{
+	INC_DWORD_STAT(STAT_QueuedHits);
+
+	FBulletHitEntry& Entry = HitQueue.AddDefaulted_GetRef();
+	Entry.HitResult = HitResult;
+	Entry.Target = HitResult.Actor;
+	Entry.Shooter = Shooter;
+	Entry.ShooterController = ShooterController;
+	Entry.Damage = Damage;
+	Entry.bHeadShot = bHeadShot;
+	Entry.bBulletHit = true;
+}
+
+void UCombatResolutionSubsystem::QueueDamage(AActor* Target, float Damage, AActor* DamageCauser, AController* InstigatorController)
+{
+	INC_DWORD_STAT(STAT_QueuedHits);
+
+	FBulletHitEntry& Entry = HitQueue.AddDefaulted_GetRef();
+	Entry.Target = Target;
+	Entry.Shooter = DamageCauser;
+	Entry.ShooterController = InstigatorController;
+	Entry.Damage = Damage;
+	Entry.bHeadShot = false;
+	Entry.bBulletHit = false;
+}
+
+void UCombatResolutionSubsystem::Tick(float DeltaTime)
+{
+	ResolveHits();
+}
+
+ETickableTickType UCombatResolutionSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UCombatResolutionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatResolutionSubsystem, STATGROUP_Tickables);
+}
+
+void UCombatResolutionSubsystem::ResolveHits()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CombatResolution);
+
+	for (int32 Round = 0; Round < MaxResolveRounds && HitQueue.Num() > 0; ++Round)
+	{
+		Swap(ResolvingHits, HitQueue);
+
+		// hits for the same target and shooter end up next to each other, in the order they were fired
+		ResolvingHits.StableSort([](const FBulletHitEntry& A, const FBulletHitEntry& B)
+		{
+			if (A.Target != B.Target) return A.Target.Get() < B.Target.Get();
+			if (A.Shooter != B.Shooter) return A.Shooter.Get() < B.Shooter.Get();
+			if (A.ShooterController != B.ShooterController) return A.ShooterController.Get() < B.ShooterController.Get();
+			return A.bBulletHit && !B.bBulletHit;
+		});
+
+		const int32 NumHits = ResolvingHits.Num();
+		for (int32 GroupStart = 0; GroupStart < NumHits;)
+		{
+			const FBulletHitEntry& First = ResolvingHits[GroupStart];
+
+			int32 GroupEnd = GroupStart + 1;
+			while (GroupEnd < NumHits
+				&& ResolvingHits[GroupEnd].Target == First.Target
+				&& ResolvingHits[GroupEnd].Shooter == First.Shooter
+				&& ResolvingHits[GroupEnd].ShooterController == First.ShooterController
+				&& ResolvingHits[GroupEnd].bBulletHit == First.bBulletHit)
+			{
+				++GroupEnd;
+			}
+
+			ResolveTarget(MakeArrayView(&ResolvingHits[GroupStart], GroupEnd - GroupStart));
+			GroupStart = GroupEnd;
+		}
+
+		ResolvingHits.Reset();
+	}
+
+	if (HitQueue.Num() > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Combat resolution: %d hits left for next frame"), HitQueue.Num());
+	}
+}
+
+void UCombatResolutionSubsystem::ResolveTarget(TArrayView<const FBulletHitEntry> TargetHits)
+{
+	const FBulletHitEntry& First = TargetHits[0];
+	AActor* Target = First.Target.Get();
+	if (!IsValid(Target))
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_ResolvedTargets);
+
+	AActor* Shooter = First.Shooter.Get();
+	AController* ShooterController = First.ShooterController.Get();
+
+	float TotalDamage = 0.f;
+	bool bHeadShot = false;
+	for (const FBulletHitEntry& Hit : TargetHits)
+	{
+		TotalDamage += Hit.Damage;
+		bHeadShot |= Hit.bHeadShot;
+	}
+
+	if (First.bBulletHit)
+	{
+		IBulletHitInterface* BulletHitInterface = Cast<IBulletHitInterface>(Target);
+		if (BulletHitInterface)
+		{
+			BulletHitInterface->BulletHitBatch(FBulletHitBatch{ TargetHits, Shooter, ShooterController, TotalDamage, bHeadShot });
+		}
+	}
+
+	if (TotalDamage > 0.f)
+	{
+		UGameplayStatics::ApplyDamage(Target, TotalDamage, ShooterController, Shooter, UDamageType::StaticClass());
+	}
+
+	AEnemy* HitEnemy = Cast<AEnemy>(Target);
+	if (HitEnemy && First.bBulletHit)
+	{
+		HitEnemy->ShowHitNumber(static_cast<int32>(TotalDamage), First.HitResult.Location, bHeadShot);
+	}
+}
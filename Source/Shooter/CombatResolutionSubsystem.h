@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "BulletHitInterface.h"
+#include "CombatResolutionSubsystem.generated.h"
+
+/**
+ * Collects every hit of the frame and resolves them together - hits are merged per target and shooter,
+ * each receiver gets one BulletHitBatch, one TakeDamage and one hit number per frame.
+ */
+UCLASS()
+class SHOOTER_API UCombatResolutionSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	void QueueBulletHit(const FHitResult& HitResult, float Damage, bool bHeadShot, AActor* Shooter, AController* ShooterController);
+
+	// damage without a bullet hit notification, e.g. explosions
+	void QueueDamage(AActor* Target, float Damage, AActor* DamageCauser, AController* InstigatorController);
+
+	// resolves everything queued so far, hits queued while resolving (explosions) are resolved too
+	void ResolveHits();
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return HitQueue.Num() > 0; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+private:
+	void ResolveTarget(TArrayView<const FBulletHitEntry> TargetHits);
+
+	TArray<FBulletHitEntry> HitQueue;
+
+	// hits being resolved, HitQueue stays free for hits queued by the receivers
+	TArray<FBulletHitEntry> ResolvingHits;
+};
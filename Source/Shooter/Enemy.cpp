@@ -5,28 +5,141 @@
 
 #include "DrawDebugHelpers.h"
 #include "EnemyController.h"
+#include "HitZoneDataAsset.h"
+#include "HitboxHistoryComponent.h"
+#include "FXPoolSubsystem.h"
+#include "AudioEventSubsystem.h"
+#include "FootstepComponent.h"
+#include "AILODSubsystem.h"
+#include "EnemyPoolSubsystem.h"
+#include "WorldUISubsystem.h"
+#include "EnemySensingSubsystem.h"
+#include "HitNumberWidget.h"
+#include "HealthBarWidget.h"
+#include "BrainComponent.h"
 #include "ShooterCharacter.h"
 #include "BehaviorTree/BlackboardComponent.h"
 #include "Blueprint/UserWidget.h"
-#include "Components/BoxComponent.h"
 #include "Components/CapsuleComponent.h"
-#include "Components/SphereComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
 #include "Engine/SkeletalMeshSocket.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Sound/SoundCue.h"
+#include "EngineUtils.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Melee sweep"), STAT_MeleeSweep, STATGROUP_Shooter);
+
+static FAutoConsoleCommandWithWorldAndArgs WeaponTraceBenchmarkCommand(
+	TEXT("shooter.WeaponTraceBenchmark"),
+	TEXT("Traces from the camera at enemies that have weapon hitboxes, against their full meshes and their hitboxes, and logs the cost of both.\n")
+	TEXT("Spawns copies of the first such enemy in front of the camera until there are EnemyCount.\n")
+	TEXT("shooter.WeaponTraceBenchmark [EnemyCount=200] [Rounds=20]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 EnemyCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200;
+		const int32 Rounds = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 20, 1);
+
+		APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		if (PlayerController == nullptr || PlayerController->PlayerCameraManager == nullptr)
+		{
+			return;
+		}
+
+		// enemies without hitboxes are traced against their mesh either way
+		TArray<AEnemy*> Enemies;
+		for (TActorIterator<AEnemy> It(World); It; ++It)
+		{
+			if (It->HasWeaponHitboxes())
+			{
+				Enemies.Add(*It);
+			}
+		}
+		if (Enemies.Num() == 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("WeaponTraceBenchmark: needs at least one enemy with weapon hitboxes in the level"));
+			return;
+		}
+
+		// fill a grid in front of the camera so all of them are in view
+		const FVector CameraLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+		const FRotator CameraRotation = PlayerController->PlayerCameraManager->GetCameraRotation();
+		const FRotationMatrix CameraAxes(FRotator(0.f, CameraRotation.Yaw, 0.f));
+		TArray<AEnemy*> SpawnedEnemies;
+		for (int32 Index = Enemies.Num(); Index < EnemyCount; ++Index)
+		{
+			const FVector Location = CameraLocation
+				+ CameraAxes.GetUnitAxis(EAxis::X) * (1000.f + (Index / 20) * 150.f)
+				+ CameraAxes.GetUnitAxis(EAxis::Y) * ((Index % 20) - 10) * 150.f;
+
+			FActorSpawnParameters SpawnParameters;
+			SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			AEnemy* Enemy = World->SpawnActor<AEnemy>(Enemies[0]->GetClass(), Location, FRotator::ZeroRotator, SpawnParameters);
+			if (Enemy)
+			{
+				SpawnedEnemies.Add(Enemy);
+				Enemies.Add(Enemy);
+			}
+		}
+
+		auto TimeTraces = [&](bool bUseMesh)
+		{
+			for (AEnemy* Enemy : Enemies)
+			{
+				Enemy->SetUseMeshForWeaponTraces(bUseMesh);
+				if (!bUseMesh)
+				{
+					// also the ones past the hitbox enable distance
+					Enemy->SetHitboxesEnabled(true);
+				}
+			}
+
+			FHitResult HitResult;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Round = 0; Round < Rounds; ++Round)
+			{
+				for (const AEnemy* Enemy : Enemies)
+				{
+					const FVector ToEnemy = Enemy->GetActorLocation() - CameraLocation;
+					World->LineTraceSingleByChannel(HitResult, CameraLocation, CameraLocation + ToEnemy * 1.25f, ECC_Weapon);
+				}
+			}
+			return (FPlatformTime::Seconds() - StartTime) * 1.0e9 / (static_cast<double>(Rounds) * Enemies.Num());
+		};
+
+		const double MeshNanoseconds = TimeTraces(true);
+		const double HitboxNanoseconds = TimeTraces(false);
+
+		UE_LOG(LogTemp, Log, TEXT("WeaponTraceBenchmark: %d enemies, %d rounds - full mesh %.0f ns per trace, hitboxes %.0f ns per trace"),
+			Enemies.Num(), Rounds, MeshNanoseconds, HitboxNanoseconds);
+
+		// back to hitboxes gated by distance
+		for (AEnemy* Enemy : Enemies)
+		{
+			Enemy->SetUseMeshForWeaponTraces(!Enemy->HasWeaponHitboxes());
+		}
+
+		for (AEnemy* Enemy : SpawnedEnemies)
+		{
+			Enemy->Destroy();
+		}
+	}));
 
 // Sets default values
 AEnemy::AEnemy() :
 	Health(100.f),
 	MaxHealth(100.f),
 	HealthBarDisplayTime(4.f),
+	HealthBarOffset(0.f, 0.f, 120.f),
 	bCanHitReact(true),
 	HitReactTimeMin(0.5f),
 	HitReactTimeMax(3.f),
 	HitNumberDestroyTime(1.5f),
+	AgroRadius(1000.f),
 	bStunned(false),
 	StunChance(0.5f),
+	CombatRangeRadius(150.f),
 	AttackLFast(TEXT("AttackLFast")),
 	AttackRFast(TEXT("AttackRFast")),
 	AttackR(TEXT("AttackR")),
@@ -34,26 +147,35 @@ AEnemy::AEnemy() :
 	BaseDamage(20.f),
 	LeftWeaponSocket(TEXT("FX_Trail_L_01")),
 	RightWeaponSocket(TEXT("FX_Trail_R_01")),
+	LeftWeaponBone(TEXT("LeftWeaponBone")),
+	RightWeaponBone(TEXT("RightWeaponBone")),
+	MeleeSweepRadius(30.f),
 	bCanAttack(true),
 	AttackWaitTime(1.f),
 	bDying(false),
-	DeathTime(4.f)
+	DeathTime(4.f),
+	HitboxEnableDistance(5000.f),
+	HitboxUpdateInterval(0.25f),
+	bHitboxesEnabled(false)
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// hit numbers and the health bar are placed by the world UI subsystem, nothing else needs a tick
+	PrimaryActorTick.bCanEverTick = false;
 
-	AgroSphere = CreateDefaultSubobject<USphereComponent>(TEXT("AgroSphere"));
-	AgroSphere->SetupAttachment(GetRootComponent());
+	HitboxHistory = CreateDefaultSubobject<UHitboxHistoryComponent>(TEXT("HitboxHistory"));
 
-	CombatRangeSphere = CreateDefaultSubobject<USphereComponent>(TEXT("CombatRange"));
-	CombatRangeSphere->SetupAttachment(GetRootComponent());
+	Footsteps = CreateDefaultSubobject<UFootstepComponent>(TEXT("Footsteps"));
 
-	LeftWeaponCollision = CreateDefaultSubobject<UBoxComponent>(TEXT("Left Weapon Box"));
-	LeftWeaponCollision->SetupAttachment(GetMesh(), FName("LeftWeaponBone"));
+}
 
-	RightWeaponCollision = CreateDefaultSubobject<UBoxComponent>(TEXT("Right Weapon Box"));
-	RightWeaponCollision->SetupAttachment(GetMesh(), FName("RightWeaponBone"));
+void AEnemy::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
 
+	// the server rewinds the same hitboxes the weapon traces hit, they are only set up here
+	if (WeaponHitboxes.Num() > 0)
+	{
+		HitboxHistory->SetShapes(WeaponHitboxes);
+	}
 }
 
 // Called when the game starts or when spawned
@@ -61,59 +183,347 @@ void AEnemy::BeginPlay()
 {
 	Super::BeginPlay();
 
-	AgroSphere->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::AgroSphereOverlap);
-
-	CombatRangeSphere->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::CombatRangeOvertlap);
-	CombatRangeSphere->OnComponentEndOverlap.AddDynamic(this, &AEnemy::CombatRangeEndOverlap);
-
-	LeftWeaponCollision->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::OnLeftWeaponOverlap);
-	RightWeaponCollision->OnComponentBeginOverlap.AddDynamic(this, &AEnemy::OnRightWeaponOverlap);
+	if (HitZones)
+	{
+		HitZones->BuildBoneLookup(GetMesh(), BoneHitZones);
+	}
 
-	GetMesh()->SetCollisionResponseToChannel(ECC_Visibility, ECollisionResponse::ECR_Block);
 	GetMesh()->SetCollisionResponseToChannel(ECC_Camera, ECollisionResponse::ECR_Ignore);
 	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Camera, ECollisionResponse::ECR_Ignore);
+	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Weapon, ECollisionResponse::ECR_Ignore);
 
-	LeftWeaponCollision->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	LeftWeaponCollision->SetCollisionObjectType(ECC_WorldDynamic);
-	LeftWeaponCollision->SetCollisionResponseToAllChannels(ECR_Ignore);
-	LeftWeaponCollision->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+	if (UFXPoolSubsystem* FXPool = GetWorld()->GetSubsystem<UFXPoolSubsystem>())
+	{
+		FXPool->Prewarm(ImpactParticles);
+	}
+
+	if (UWorldUISubsystem* WorldUI = GetWorld()->GetSubsystem<UWorldUISubsystem>())
+	{
+		WorldUI->Prewarm(HitNumberWidgetClass, 8);
+		WorldUI->Prewarm(HealthBarWidgetClass, 2);
+	}
 
-	RightWeaponCollision->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	RightWeaponCollision->SetCollisionObjectType(ECC_WorldDynamic);
-	RightWeaponCollision->SetCollisionResponseToAllChannels(ECR_Ignore);
-	RightWeaponCollision->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+	// bullets and the crosshair hit the hitboxes, the mesh only when there are none
+	CreateWeaponHitboxes();
+	SetUseMeshForWeaponTraces(!HasWeaponHitboxes());
+	CacheHitZones();
 
 	// get AI Controller
 	EnemyController = Cast<AEnemyController>(GetController());
 
-	if (EnemyController)
+	StartBehavior();
+
+	if (UAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UAILODSubsystem>())
+	{
+		AILOD->RegisterEnemy(this);
+	}
+
+	if (UEnemySensingSubsystem* Sensing = GetWorld()->GetSubsystem<UEnemySensingSubsystem>())
+	{
+		Sensing->RegisterEnemy(this);
+	}
+	
+}
+
+void AEnemy::StartBehavior()
+{
+	if (EnemyController == nullptr)
 	{
-		EnemyController->GetBlackboardComponent()->SetValueAsBool(FName("CanAttack"), true);
+		return;
 	}
 
+	FEnemyBlackboard& Blackboard = EnemyController->GetEnemyBlackboard();
+	Blackboard.SetTarget(nullptr);
+	Blackboard.SetDead(false);
+	Blackboard.SetStunned(false);
+	Blackboard.SetInAttackRange(false);
+	Blackboard.SetCanAttack(true);
+
 	const FVector WorldPatrolPoint = UKismetMathLibrary::TransformLocation(GetActorTransform(), PatrolPoint);
 	const FVector WorldPatrolPoint2 = UKismetMathLibrary::TransformLocation(GetActorTransform(), PatrolPoint2);
 
 	//DrawDebugSphere(GetWorld(), WorldPatrolPoint, 25.f, 12, FColor::Red, true);
 	//DrawDebugSphere(GetWorld(), WorldPatrolPoint2, 25.f, 12, FColor::Red, true);
 
+	// both patrol points are set before the tree starts, so it only runs once
+	Blackboard.SetPatrolPoint(WorldPatrolPoint);
+	Blackboard.SetPatrolPoint2(WorldPatrolPoint2);
+	Blackboard.Flush();
+	EnemyController->RunBehaviorTree(BehaviorTree);
+}
+
+void AEnemy::DeactivateForPool()
+{
+	if (UAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UAILODSubsystem>())
+	{
+		AILOD->UnregisterEnemy(this);
+	}
+
+	if (UEnemySensingSubsystem* Sensing = GetWorld()->GetSubsystem<UEnemySensingSubsystem>())
+	{
+		Sensing->UnregisterEnemy(this);
+	}
+
 	if (EnemyController)
 	{
-		EnemyController->GetBlacboardCompomponent()->SetValueAsVector(TEXT("PatrolPoint"), WorldPatrolPoint);
-		EnemyController->RunBehaviorTree(BehaviorTree);
+		EnemyController->StopMovement();
+		if (EnemyController->GetBrainComponent())
+		{
+			EnemyController->GetBrainComponent()->StopLogic(TEXT("Pooled"));
+		}
+	}
+
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+	HideHealthBar();
 
-		EnemyController->GetBlacboardCompomponent()->SetValueAsVector(TEXT("PatrolPoint2"), WorldPatrolPoint2);
-		EnemyController->RunBehaviorTree(BehaviorTree);
+	EndMeleeSweep(true);
+	EndMeleeSweep(false);
+	SetHitboxesEnabled(false);
+
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+	GetCharacterMovement()->SetComponentTickEnabled(false);
+	GetMesh()->SetComponentTickEnabled(false);
+	HitboxHistory->SetComponentTickEnabled(false);
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+void AEnemy::ActivateFromPool(const FTransform& Transform)
+{
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	HitboxHistory->ClearHistory();
+
+	Health = MaxHealth;
+	bDying = false;
+	bStunned = false;
+	bCanHitReact = true;
+	bCanAttack = true;
+	bInAttackRange = false;
+
+	GetMesh()->bPauseAnims = false;
+	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
+	{
+		AnimInstance->StopAllMontages(0.f);
+	}
+
+	GetCharacterMovement()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->SetMovementMode(MOVE_Walking);
+	GetMesh()->SetComponentTickEnabled(true);
+	HitboxHistory->SetComponentTickEnabled(true);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	if (HasWeaponHitboxes())
+	{
+		UpdateHitboxCollision();
+		GetWorldTimerManager().SetTimer(HitboxUpdateTimer, this, &AEnemy::UpdateHitboxCollision, HitboxUpdateInterval, true);
+	}
+
+	StartBehavior();
+
+	if (UAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UAILODSubsystem>())
+	{
+		AILOD->RegisterEnemy(this);
+	}
+
+	if (UEnemySensingSubsystem* Sensing = GetWorld()->GetSubsystem<UEnemySensingSubsystem>())
+	{
+		Sensing->RegisterEnemy(this);
+	}
+}
+
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UAILODSubsystem>())
+	{
+		AILOD->UnregisterEnemy(this);
+	}
+
+	if (UEnemySensingSubsystem* Sensing = GetWorld()->GetSubsystem<UEnemySensingSubsystem>())
+	{
+		Sensing->UnregisterEnemy(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool AEnemy::IsInCombat() const
+{
+	if (bInAttackRange || bDying)
+	{
+		return true;
+	}
+
+	return EnemyController && EnemyController->GetEnemyBlackboard().GetTarget() != nullptr;
+}
+
+FResolvedHitZone AEnemy::GetHitZone(const FHitResult& HitResult) const
+{
+	// hitbox capsules stand in for the bone they are attached to
+	const int32 HitboxIndex = HitboxComponents.IndexOfByKey(HitResult.GetComponent());
+	if (HitboxHitZones.IsValidIndex(HitboxIndex))
+	{
+		return HitboxHitZones[HitboxIndex];
+	}
+
+	// mesh hits carry the index of the physics body they hit
+	if (HitResult.GetComponent() == GetMesh() && BodyHitZones.IsValidIndex(HitResult.Item))
+	{
+		return BodyHitZones[HitResult.Item];
+	}
+
+	return BoneHitZones.Num() == 0 && HitResult.BoneName == HeadBone ? FResolvedHitZone{ EHitZone::EHZ_Head, 1.f } : FResolvedHitZone{ EHitZone::EHZ_Torso, 1.f };
+}
+
+FResolvedHitZone AEnemy::GetBoneHitZone(int32 BoneIndex) const
+{
+	if (BoneHitZones.Num() == 0)
+	{
+		// no hit zone asset - only head or body
+		return BoneIndex != INDEX_NONE && GetMesh()->GetBoneName(BoneIndex) == HeadBone ? FResolvedHitZone{ EHitZone::EHZ_Head, 1.f } : FResolvedHitZone{ EHitZone::EHZ_Torso, 1.f };
+	}
+
+	return BoneHitZones.IsValidIndex(BoneIndex) ? BoneHitZones[BoneIndex] : FResolvedHitZone{ EHitZone::EHZ_Torso, 1.f };
+}
+
+void AEnemy::CacheHitZones()
+{
+	HitboxHitZones.Reset(HitboxComponents.Num());
+	for (int32 Index = 0; Index < HitboxComponents.Num(); ++Index)
+	{
+		const FHitboxShape& Shape = WeaponHitboxes[Index];
+		HitboxHitZones.Add(BoneHitZones.Num() == 0 ? FResolvedHitZone{ Shape.Zone, 1.f } : GetBoneHitZone(GetMesh()->GetBoneIndex(Shape.BoneName)));
+	}
+
+	const TArray<FBodyInstance*>& Bodies = GetMesh()->Bodies;
+	BodyHitZones.Reset(Bodies.Num());
+	for (const FBodyInstance* Body : Bodies)
+	{
+		BodyHitZones.Add(GetBoneHitZone(Body ? Body->InstanceBoneIndex : INDEX_NONE));
+	}
+}
+
+void AEnemy::CreateWeaponHitboxes()
+{
+	for (const FHitboxShape& Shape : WeaponHitboxes)
+	{
+		UCapsuleComponent* Hitbox = NewObject<UCapsuleComponent>(this);
+		Hitbox->SetupAttachment(GetMesh(), Shape.BoneName);
+		Hitbox->SetCapsuleSize(Shape.Radius, Shape.HalfHeight + Shape.Radius);
+
+		// capsules are built along Z, turn them onto the bone axis
+		if (Shape.Axis == EAxis::X)
+		{
+			Hitbox->SetRelativeRotation(FRotator(90.f, 0.f, 0.f));
+		}
+		else if (Shape.Axis == EAxis::Y)
+		{
+			Hitbox->SetRelativeRotation(FRotator(0.f, 0.f, 90.f));
+		}
+
+		// query only shapes for weapon and crosshair traces, nothing else touches them
+		Hitbox->SetCollisionObjectType(ECC_WorldDynamic);
+		Hitbox->SetCollisionResponseToAllChannels(ECR_Ignore);
+		Hitbox->SetCollisionResponseToChannel(ECC_Weapon, ECR_Block);
+		Hitbox->SetCollisionResponseToChannel(ECC_Visibility, ECR_Block);
+		Hitbox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Hitbox->SetGenerateOverlapEvents(false);
+		Hitbox->SetCanEverAffectNavigation(false);
+		Hitbox->RegisterComponent();
+
+		HitboxComponents.Add(Hitbox);
+	}
+
+	if (HasWeaponHitboxes())
+	{
+		UpdateHitboxCollision();
+		GetWorldTimerManager().SetTimer(HitboxUpdateTimer, this, &AEnemy::UpdateHitboxCollision, HitboxUpdateInterval, true);
+	}
+}
+
+void AEnemy::UpdateHitboxCollision()
+{
+	const float EnableDistanceSquared = FMath::Square(HitboxEnableDistance);
+
+	bool bPlayerNear = false;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APawn* PlayerPawn = It->Get() ? It->Get()->GetPawn() : nullptr;
+		if (PlayerPawn && FVector::DistSquared(PlayerPawn->GetActorLocation(), GetActorLocation()) <= EnableDistanceSquared)
+		{
+			bPlayerNear = true;
+			break;
+		}
+	}
+
+	if (bPlayerNear != bHitboxesEnabled)
+	{
+		SetHitboxesEnabled(bPlayerNear);
+	}
+}
+
+void AEnemy::SetHitboxesEnabled(bool bEnabled)
+{
+	bHitboxesEnabled = bEnabled;
+	for (UCapsuleComponent* Hitbox : HitboxComponents)
+	{
+		Hitbox->SetCollisionEnabled(bEnabled ? ECollisionEnabled::QueryOnly : ECollisionEnabled::NoCollision);
+	}
+}
+
+void AEnemy::SetUseMeshForWeaponTraces(bool bUseMesh)
+{
+	const ECollisionResponse MeshResponse = bUseMesh ? ECR_Block : ECR_Ignore;
+	GetMesh()->SetCollisionResponseToChannel(ECC_Visibility, MeshResponse);
+	GetMesh()->SetCollisionResponseToChannel(ECC_Weapon, MeshResponse);
+
+	if (HasWeaponHitboxes())
+	{
+		// back to the distance gating when the mesh stops taking traces
+		if (bUseMesh)
+		{
+			SetHitboxesEnabled(false);
+		}
+		else
+		{
+			UpdateHitboxCollision();
+		}
 	}
-	
 }
 
 void AEnemy::ShowHealthBar_Implementation()
 {
+	UWorldUISubsystem* WorldUI = GetWorld()->GetSubsystem<UWorldUISubsystem>();
+	if (HealthBarWidgetClass && WorldUI)
+	{
+		// the subsystem expires the bar, no timer needed
+		WorldUI->ShowHealthBar(HealthBarWidgetClass, this, HealthBarOffset, MaxHealth > 0.f ? Health / MaxHealth : 0.f, HealthBarDisplayTime);
+		return;
+	}
+
 	GetWorldTimerManager().ClearTimer(HeathBarTimer);
 	GetWorldTimerManager().SetTimer(HeathBarTimer, this, &AEnemy::HideHealthBar, HealthBarDisplayTime);
 }
 
+void AEnemy::HideHealthBar_Implementation()
+{
+	if (UWorldUISubsystem* WorldUI = GetWorld()->GetSubsystem<UWorldUISubsystem>())
+	{
+		WorldUI->HideHealthBar(this);
+	}
+}
+
+void AEnemy::ShowHitNumber_Implementation(int32 Damage, FVector HitLocation, bool bHeadShot)
+{
+	if (UWorldUISubsystem* WorldUI = GetWorld()->GetSubsystem<UWorldUISubsystem>())
+	{
+		WorldUI->ShowHitNumber(HitNumberWidgetClass, Damage, HitLocation, bHeadShot, HitNumberDestroyTime);
+	}
+}
+
 void AEnemy::Die()
 {
 	if (bDying)
@@ -132,7 +542,7 @@ void AEnemy::Die()
 
 	if (EnemyController)
 	{
-		EnemyController->GetBlacboardCompomponent()->SetValueAsBool(FName("Dead"), true);
+		EnemyController->GetEnemyBlackboard().SetDead(true);
 		EnemyController->StopMovement();
 	}
 }
@@ -161,60 +571,24 @@ void AEnemy::ResetHitReactTimer()
 
 void AEnemy::StoreHitNumber(UUserWidget* Hitnumber, FVector Locaiton)
 {
-	Hitnumbers.Add(Hitnumber, Locaiton);
-
-	FTimerHandle HitNumberTimer;
-	FTimerDelegate HitNumberDelegate;
-	HitNumberDelegate.BindUFunction(this, FName("DestroyHitNumber"), Hitnumber);
-	GetWorld()->GetTimerManager().SetTimer(HitNumberTimer, HitNumberDelegate, HitNumberDestroyTime, false);
-}
-
-void AEnemy::DestroyHitNumber(UUserWidget* HitNumber)
-{
-
-	Hitnumbers.Remove(HitNumber);
-	HitNumber->RemoveFromParent();
-}
-
-void AEnemy::UpdateHitNumbers()
-{
-	for (auto &HitPair : Hitnumbers)
+	// the subsystem positions it every frame and removes it after HitNumberDestroyTime
+	if (UWorldUISubsystem* WorldUI = GetWorld()->GetSubsystem<UWorldUISubsystem>())
 	{
-		UUserWidget* HitNumber = HitPair.Key;
-		const FVector Location = HitPair.Value;
-
-		FVector2D ScreenPosition;
-
-		UGameplayStatics::ProjectWorldToScreen(GetWorld()->GetFirstPlayerController(), Location, ScreenPosition);
-
-		HitNumber->SetPositionInViewport(ScreenPosition);
+		WorldUI->AddWidgetMarker(Hitnumber, Locaiton, HitNumberDestroyTime);
 	}
 }
 
-void AEnemy::AgroSphereOverlap(UPrimitiveComponent* OverlappedComp,
-	AActor* OtherActor,
-	UPrimitiveComponent* OtherComp,
-	int32 OtherBodyIndex,
-	bool bFromSweep,
-	const FHitResult& SweepResult)
+void AEnemy::OnPlayerEnteredAgroRange(AShooterCharacter* Character)
 {
-	if (OtherActor == nullptr)
+	if (EnemyController)
 	{
-		return;
+		// set the value of the blackboard "Target" Key
+		EnemyController->GetEnemyBlackboard().SetTarget(Character);
 	}
 
-	AShooterCharacter* Character = Cast<AShooterCharacter>(OtherActor);
-	if (Character)
+	if (UAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UAILODSubsystem>())
 	{
-		if (EnemyController)
-		{
-			if (EnemyController->GetBlacboardCompomponent())
-			{
-				// set the value of the blackboard "Target" Key
-				EnemyController->GetBlacboardCompomponent()->SetValueAsObject(TEXT("Target"), Character);
-			}
-		}
-		
+		AILOD->PromoteToFullRate(this);
 	}
 }
 
@@ -224,44 +598,23 @@ void AEnemy::SetStunned(bool Stunned)
 
 	if (EnemyController)
 	{
-		EnemyController->GetBlacboardCompomponent()->SetValueAsBool(TEXT("Stunned"), Stunned);
-	}
-}
-
-void AEnemy::CombatRangeOvertlap(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
-	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
-{
-	if (OtherActor == nullptr)
-	{
-		return;
-	}
-
-	AShooterCharacter* ShooterCharacter = Cast<AShooterCharacter>(OtherActor);
-	if (ShooterCharacter)
-	{
-		bInAttackRange = true;
-		if (EnemyController)
-		{
-			EnemyController->GetBlacboardCompomponent()->SetValueAsBool(TEXT("InAttackRange"), true);
-		}
+		EnemyController->GetEnemyBlackboard().SetStunned(Stunned);
 	}
 }
 
-void AEnemy::CombatRangeEndOverlap(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
-	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+void AEnemy::SetInAttackRange(bool bInRange)
 {
-	if (OtherActor == nullptr)
+	bInAttackRange = bInRange;
+	if (EnemyController)
 	{
-		return;
+		EnemyController->GetEnemyBlackboard().SetInAttackRange(bInRange);
 	}
 
-	AShooterCharacter* ShooterCharacter = Cast<AShooterCharacter>(OtherActor);
-	if (ShooterCharacter)
+	if (bInRange)
 	{
-		bInAttackRange = false;
-		if (EnemyController)
+		if (UAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UAILODSubsystem>())
 		{
-			EnemyController->GetBlacboardCompomponent()->SetValueAsBool(TEXT("InAttackRange"), false);
+			AILOD->PromoteToFullRate(this);
 		}
 	}
 }
@@ -279,7 +632,7 @@ void AEnemy::PlayAttackMontage(FName Section, float Playrate)
 
 	if (EnemyController)
 	{
-		EnemyController->GetBlackboardComponent()->SetValueAsBool(FName("CanAttack"),false);
+		EnemyController->GetEnemyBlackboard().SetCanAttack(false);
 	}
 }
 
@@ -318,7 +671,7 @@ void AEnemy::DoDamage(AShooterCharacter* Victim)
 
 	if (Victim->GetMeleeImpactSound())
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, Victim->GetMeleeImpactSound(), GetActorLocation());
+		UAudioEventSubsystem::PlaySoundAtLocation(this, EAudioEventCategory::EAEC_Melee, Victim->GetMeleeImpactSound(), GetActorLocation());
 	}
 }
 
@@ -330,7 +683,7 @@ void AEnemy::SpawnBlood(AShooterCharacter* Victim, FName SocketName)
 		const FTransform SocketTransform = TipSocket->GetSocketTransform(GetMesh());
 		if (Victim->GetBloodParticles())
 		{
-			UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Victim->GetBloodParticles(), SocketTransform);
+			UFXPoolSubsystem::SpawnFXAtLocation(this, Victim->GetBloodParticles(), SocketTransform);
 		}
 	}
 }
@@ -347,50 +700,59 @@ void AEnemy::StunCharacter(AShooterCharacter* Victim)
 	}
 }
 
+void AEnemy::HitMeleeVictim(AShooterCharacter* Victim, FName BloodSocket)
+{
+	DoDamage(Victim);
+	SpawnBlood(Victim, BloodSocket);
+	StunCharacter(Victim);
+}
 
-void AEnemy::OnLeftWeaponOverlap(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
-                                 UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AEnemy::BeginMeleeSweep(bool bLeftWeapon)
 {
-	AShooterCharacter* Character = Cast<AShooterCharacter>(OtherActor);
-	if (Character)
-	{
-		DoDamage(Character);
-		SpawnBlood(Character, LeftWeaponSocket);
-		StunCharacter(Character);
-	}
-	
+	FMeleeSweep& Sweep = bLeftWeapon ? LeftMeleeSweep : RightMeleeSweep;
+	Sweep.LastLocation = GetMesh()->GetSocketLocation(bLeftWeapon ? LeftWeaponBone : RightWeaponBone);
+	Sweep.Victims.Reset();
+	Sweep.bActive = true;
+
+	// the first sweep is just the bone's position, in case the swing starts inside the player
+	UpdateMeleeSweep(bLeftWeapon);
 }
 
-void AEnemy::OnRightWeaponOverlap(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
-	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AEnemy::UpdateMeleeSweep(bool bLeftWeapon)
 {
-	AShooterCharacter* Character = Cast<AShooterCharacter>(OtherActor);
-	if (Character)
+	FMeleeSweep& Sweep = bLeftWeapon ? LeftMeleeSweep : RightMeleeSweep;
+	if (!Sweep.bActive)
 	{
-		DoDamage(Character);
-		SpawnBlood(Character, RightWeaponSocket);
-		StunCharacter(Character);
+		return;
 	}
-}
 
-void AEnemy::ActivateLeftWeapon()
-{
-	LeftWeaponCollision->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-}
+	SCOPE_CYCLE_COUNTER(STAT_MeleeSweep);
 
-void AEnemy::DeactivateLeftWeapon()
-{
-	LeftWeaponCollision->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-}
+	// one sphere sweep along the path the bone took since the last frame, so fast swings don't skip the player
+	const FVector Location = GetMesh()->GetSocketLocation(bLeftWeapon ? LeftWeaponBone : RightWeaponBone);
 
-void AEnemy::ActivateRightWeapon()
-{
-	RightWeaponCollision->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MeleeSweep), false, this);
+	MeleeSweepHits.Reset();
+	GetWorld()->SweepMultiByObjectType(MeleeSweepHits, Sweep.LastLocation, Location, FQuat::Identity,
+		FCollisionObjectQueryParams(ECC_Pawn), FCollisionShape::MakeSphere(MeleeSweepRadius), QueryParams);
+	Sweep.LastLocation = Location;
+
+	for (const FHitResult& Hit : MeleeSweepHits)
+	{
+		AShooterCharacter* Victim = Cast<AShooterCharacter>(Hit.GetActor());
+		if (Victim && !Sweep.Victims.Contains(Victim))
+		{
+			Sweep.Victims.Add(Victim);
+			HitMeleeVictim(Victim, bLeftWeapon ? LeftWeaponSocket : RightWeaponSocket);
+		}
+	}
 }
 
-void AEnemy::DeactivateRightWeapon()
+void AEnemy::EndMeleeSweep(bool bLeftWeapon)
 {
-	RightWeaponCollision->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	FMeleeSweep& Sweep = bLeftWeapon ? LeftMeleeSweep : RightMeleeSweep;
+	Sweep.Victims.Reset();
+	Sweep.bActive = false;
 }
 
 void AEnemy::ResetCanAttack()
@@ -398,7 +760,7 @@ void AEnemy::ResetCanAttack()
 	bCanAttack = true;
 	if (EnemyController)
 	{
-		EnemyController->GetBlackboardComponent()->SetValueAsBool(FName("CanAttack"), true);
+		EnemyController->GetEnemyBlackboard().SetCanAttack(true);
 	}
 }
 
@@ -410,18 +772,17 @@ void AEnemy::FinishDeath()
 
 void AEnemy::DestroyEnemy()
 {
+	// kept for the next spawn unless the pool is full
+	UEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UEnemyPoolSubsystem>();
+	if (EnemyPool && EnemyPool->ReleaseEnemy(this))
+	{
+		return;
+	}
+
 	Destroy();
 }
 
 
-// Called every frame
-void AEnemy::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-	UpdateHitNumbers();
-
-}
-
 // Called to bind functionality to input
 void AEnemy::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
@@ -429,27 +790,50 @@ void AEnemy::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 
 }
 
-void AEnemy::BulletHit_Implementation(FHitResult HitResult, AActor* Shooter, AController* ShooterContorller)
+void AEnemy::BulletHit_Implementation(const FHitResult& HitResult, AActor* Shooter, AController* ShooterContorller)
 {
 	if (ImpactSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
+		UAudioEventSubsystem::PlaySoundAtLocation(this, EAudioEventCategory::EAEC_Impact, ImpactSound, GetActorLocation());
 	}
 
 	if (ImpactParticles)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ImpactParticles, HitResult.Location, FRotator(0.f), true);
+		UFXPoolSubsystem::SpawnFXAtLocation(this, ImpactParticles, FTransform(HitResult.Location));
 	}
 
 	
 }
 
+void AEnemy::BulletHitBatch(const FBulletHitBatch& Batch)
+{
+	// one impact sound for all the hits of the frame
+	if (ImpactSound)
+	{
+		UAudioEventSubsystem::PlaySoundAtLocation(this, EAudioEventCategory::EAEC_Impact, ImpactSound, GetActorLocation());
+	}
+
+	UFXPoolSubsystem* FXPool = GetWorld()->GetSubsystem<UFXPoolSubsystem>();
+	if (ImpactParticles && FXPool)
+	{
+		for (const FBulletHitEntry& Hit : Batch.Hits)
+		{
+			FXPool->SpawnFX(ImpactParticles, Hit.HitResult.Location);
+		}
+	}
+}
+
 float AEnemy::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
-	// set the target in blackboard
+	// set the target in blackboard, repeated hits from the same causer don't write
 	if (EnemyController)
 	{
-		EnemyController->GetBlacboardCompomponent()->SetValueAsObject(FName("Target"), DamageCauser);
+		EnemyController->GetEnemyBlackboard().SetTarget(DamageCauser);
+	}
+
+	if (UAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UAILODSubsystem>())
+	{
+		AILOD->PromoteToFullRate(this);
 	}
 
 	if ((Health - DamageAmount) <= 0)
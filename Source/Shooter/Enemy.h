@@ -6,8 +6,21 @@
 
 #include "GameFramework/Character.h"
 #include "BulletHitInterface.h"
+#include "HitZone.h"
+#include "HitboxHistoryComponent.h"
 #include "Enemy.generated.h"
 
+// one melee window of one weapon
+struct FMeleeSweep
+{
+	FVector LastLocation = FVector::ZeroVector;
+
+	// hit once per swing
+	TArray<TWeakObjectPtr<AActor>, TInlineAllocator<4>> Victims;
+
+	bool bActive = false;
+};
+
 UCLASS()
 class SHOOTER_API AEnemy : public ACharacter, public  IBulletHitInterface
 {
@@ -21,12 +34,17 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void PostInitializeComponents() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UFUNCTION(BlueprintNativeEvent)
 	void ShowHealthBar();
 	void ShowHealthBar_Implementation();
 
-	UFUNCTION(BlueprintImplementableEvent)
+	UFUNCTION(BlueprintNativeEvent)
 	void HideHealthBar();
+	void HideHealthBar_Implementation();
 
 	void Die();
 
@@ -34,81 +52,19 @@ protected:
 
 	void ResetHitReactTimer();
 
+	// places a hit number made in blueprint through the world UI subsystem
 	UFUNCTION(BlueprintCallable)
 	void StoreHitNumber(UUserWidget* Hitnumber, FVector Locaiton);
 
-	UFUNCTION()
-	void DestroyHitNumber(UUserWidget* HitNumber);
-
-	void UpdateHitNumbers();
-
-	UFUNCTION()
-	void AgroSphereOverlap(
-		UPrimitiveComponent* OverlappedComp,
-		AActor* OtherActor,
-		UPrimitiveComponent* OtherComp,
-		int32 OtherBodyIndex,
-		bool bFromSweep,
-		const FHitResult& SweepResult
-	);
-
 	UFUNCTION(BlueprintCallable)
 	void SetStunned(bool Stunned);
 
-	UFUNCTION()
-	void CombatRangeOvertlap(
-		UPrimitiveComponent* OverlappedComp,
-		AActor* OtherActor,
-		UPrimitiveComponent* OtherComp,
-		int32 OtherBodyIndex,
-		bool bFromSweep,
-		const FHitResult& SweepResult
-	);
-
-	UFUNCTION()
-	void CombatRangeEndOverlap(
-		UPrimitiveComponent* OverlappedComp,
-		AActor* OtherActor,
-		UPrimitiveComponent* OtherComp,
-		int32 OtherBodyIndex
-	);
-
 	UFUNCTION(BlueprintCallable)
 	void PlayAttackMontage(FName Section, float Playrate = 1.0f);
 
 	UFUNCTION(BlueprintPure)
 	FName GetAttackSectionName();
 
-	UFUNCTION()
-	void OnLeftWeaponOverlap(
-		UPrimitiveComponent* OverlappedComp,
-		AActor* OtherActor,
-		UPrimitiveComponent* OtherComp,
-		int32 OtherBodyIndex,
-		bool bFromSweep,
-		const FHitResult& SweepResult
-	);
-
-	UFUNCTION()
-		void OnRightWeaponOverlap(
-			UPrimitiveComponent* OverlappedComp,
-			AActor* OtherActor,
-			UPrimitiveComponent* OtherComp,
-			int32 OtherBodyIndex,
-			bool bFromSweep,
-			const FHitResult& SweepResult
-		);
-
-	UFUNCTION(BlueprintCallable)
-	void ActivateLeftWeapon();
-	UFUNCTION(BlueprintCallable)
-	void DeactivateLeftWeapon();
-
-	UFUNCTION(BlueprintCallable)
-	void ActivateRightWeapon();
-	UFUNCTION(BlueprintCallable)
-	void DeactivateRightWeapon();
-
 	void ResetCanAttack();
 
 	UFUNCTION(BlueprintCallable)
@@ -117,6 +73,9 @@ protected:
 	UFUNCTION()
 	void DestroyEnemy();
 
+	// blackboard reset, patrol points from the current transform, then the behavior tree
+	void StartBehavior();
+
 private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	class UParticleSystem* ImpactParticles;
@@ -130,12 +89,64 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float MaxHealth;
 
+	// used as the only head bone when there is no HitZones asset
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	FString HeadBone;
+	FName HeadBone;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	class UHitZoneDataAsset* HitZones;
+
+	// HitZones resolved against the mesh, indexed by bone index
+	TArray<FResolvedHitZone> BoneHitZones;
+
+	// the same zones by hitbox index and by physics body index, so a hit needs no bone lookup
+	TArray<FResolvedHitZone> HitboxHitZones;
+	TArray<FResolvedHitZone> BodyHitZones;
+
+	FResolvedHitZone GetBoneHitZone(int32 BoneIndex) const;
+	void CacheHitZones();
+
+	// capsules on key bones that weapon traces hit instead of the skeletal mesh, empty keeps the mesh blocking bullets
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat|Hitboxes", meta = (AllowPrivateAccess = "true"))
+	TArray<FHitboxShape> WeaponHitboxes;
+
+	// hitboxes only take queries while a player is this close
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat|Hitboxes", meta = (AllowPrivateAccess = "true"))
+	float HitboxEnableDistance;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Combat|Hitboxes", meta = (AllowPrivateAccess = "true"))
+	float HitboxUpdateInterval;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "Combat|Hitboxes", meta = (AllowPrivateAccess = "true"))
+	TArray<class UCapsuleComponent*> HitboxComponents;
+
+	bool bHitboxesEnabled;
+
+	FTimerHandle HitboxUpdateTimer;
+
+	void CreateWeaponHitboxes();
+
+	// turns the hitboxes on when a player gets close, off when all players are far away
+	void UpdateHitboxCollision();
+
+	// hitbox poses recorded on the server for rewinding shots
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	class UHitboxHistoryComponent* HitboxHistory;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Audio, meta = (AllowPrivateAccess = "true"))
+	class UFootstepComponent* Footsteps;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float HealthBarDisplayTime;
 
+	// pooled health bar placed by the world UI subsystem, unset leaves the health bar to blueprint
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<class UHealthBarWidget> HealthBarWidgetClass;
+
+	// from the actor location
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	FVector HealthBarOffset;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	FTimerHandle HeathBarTimer;
 
@@ -153,12 +164,13 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float HitReactTimeMax;
 
-	UPROPERTY(VisibleAnywhere, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	TMap<UUserWidget*, FVector> Hitnumbers;
-
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float HitNumberDestroyTime;
 
+	// pooled hit number placed by the world UI subsystem, used unless blueprint overrides ShowHitNumber
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<class UHitNumberWidget> HitNumberWidgetClass;
+
 	UPROPERTY(EditAnywhere, Category= "Behavior Tree", meta = (AllowPrivateAccess = "true"))
 	class UBehaviorTree* BehaviorTree;
 
@@ -170,9 +182,9 @@ private:
 
 	class AEnemyController* EnemyController;
 
-	// overlap sphere for whene enemy becomes hostile
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true", MakeEditWidget = "true"))
-	class USphereComponent* AgroSphere;
+	// enemy becomes hostile when a player comes this close, sensed by the enemy sensing subsystem
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	float AgroRadius;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true", MakeEditWidget = "true"))
 	bool bStunned;
@@ -183,8 +195,9 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true", MakeEditWidget = "true"))
 	bool bInAttackRange;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true", MakeEditWidget = "true"))
-	USphereComponent* CombatRangeSphere;
+	// players closer than this are in attack range
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	float CombatRangeRadius;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	UAnimMontage* AttackMontage;
@@ -194,12 +207,6 @@ private:
 	FName AttackL;
 	FName AttackR;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	class UBoxComponent* LeftWeaponCollision;
-
-	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UBoxComponent* RightWeaponCollision;
-
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float BaseDamage;
 
@@ -214,6 +221,25 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	FName RightWeaponSocket;
 
+	// bones swept by the melee sweep notify state
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	FName LeftWeaponBone;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	FName RightWeaponBone;
+
+	// radius of the sphere swept along the weapon bone's path
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	float MeleeSweepRadius;
+
+	FMeleeSweep LeftMeleeSweep;
+	FMeleeSweep RightMeleeSweep;
+
+	// reused by every sweep, the scene query only takes a heap allocated array
+	TArray<FHitResult> MeleeSweepHits;
+
+	void HitMeleeVictim(AShooterCharacter* Victim, FName BloodSocket);
+
 	UPROPERTY(VisibleAnywhere, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	bool bCanAttack;
 
@@ -233,21 +259,61 @@ private:
 	float DeathTime;
 
 public:
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
-	virtual void BulletHit_Implementation(FHitResult HitResult, AActor* Shooter, AController* ShooterContorller) override;
+	virtual void BulletHit_Implementation(const FHitResult& HitResult, AActor* Shooter, AController* ShooterContorller) override;
+
+	// one impact sound for all hits of the frame
+	virtual void BulletHitBatch(const FBulletHitBatch& Batch) override;
 
 	virtual float TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 
-	FORCEINLINE FString GetHeadBone() const { return HeadBone; }
+	FORCEINLINE FName GetHeadBone() const { return HeadBone; }
+
+	FResolvedHitZone GetHitZone(const FHitResult& HitResult) const;
+
+	void SetHitboxesEnabled(bool bEnabled);
+
+	// weapon traces hit the full skeletal mesh instead of the hitboxes, for comparing trace cost;
+	// switching back leaves the hitboxes to the distance gating
+	void SetUseMeshForWeaponTraces(bool bUseMesh);
+
+	FORCEINLINE bool HasWeaponHitboxes() const { return HitboxComponents.Num() > 0; }
 
-	UFUNCTION(BlueprintImplementableEvent)
+	UFUNCTION(BlueprintNativeEvent)
 	void ShowHitNumber(int32 Damage, FVector HitLocation, bool bHeadShot);
+	void ShowHitNumber_Implementation(int32 Damage, FVector HitLocation, bool bHeadShot);
 
 	FORCEINLINE UBehaviorTree* GetBehaviorTree() const { return  BehaviorTree; }
+
+	// has a target, is attacking or dying - keeps the AI at full rate
+	bool IsInCombat() const;
+
+	FORCEINLINE float GetAgroRadius() const { return AgroRadius; }
+	FORCEINLINE float GetCombatRangeRadius() const { return CombatRangeRadius; }
+
+	// sent by the enemy sensing subsystem
+	void OnPlayerEnteredAgroRange(class AShooterCharacter* Character);
+	void SetInAttackRange(bool bInRange);
+
+	FORCEINLINE float GetHealth() const { return Health; }
+	FORCEINLINE float GetMaxHealth() const { return MaxHealth; }
+
+	// horde agents keep the health they had as a simulation row when promoted
+	FORCEINLINE void SetHealth(float NewHealth) { Health = FMath::Clamp(NewHealth, 0.f, MaxHealth); }
+
+	FORCEINLINE bool IsDying() const { return bDying; }
+
+	// melee windows, sent by UAnimNotifyState_MeleeSweep
+	void BeginMeleeSweep(bool bLeftWeapon);
+	void UpdateMeleeSweep(bool bLeftWeapon);
+	void EndMeleeSweep(bool bLeftWeapon);
+
+	// hides the dead enemy and stops everything that ticks or collides, for the enemy pool
+	void DeactivateForPool();
+
+	// back to a freshly spawned state at Transform
+	void ActivateFromPool(const FTransform& Transform);
 	
 };
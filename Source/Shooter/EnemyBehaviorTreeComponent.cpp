@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyBehaviorTreeComponent.h"
+
+void UEnemyBehaviorTreeComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	SkippedTime += DeltaTime;
+	if (SkippedTime < ThinkInterval)
+	{
+		return;
+	}
+
+	const float ElapsedTime = SkippedTime;
+	SkippedTime = 0.f;
+	Super::TickComponent(ElapsedTime, TickType, ThisTickFunction);
+}
+
+void UEnemyBehaviorTreeComponent::SetThinkInterval(float Interval)
+{
+	// promoting thinks on the next tick
+	if (Interval < ThinkInterval)
+	{
+		SkippedTime = Interval;
+	}
+	ThinkInterval = Interval;
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "EnemyBehaviorTreeComponent.generated.h"
+
+/**
+ * Behavior tree component that can think less often than every frame.
+ * The tree schedules its own tick interval, so skipped ticks are accumulated here
+ * and the tree and its services get the whole elapsed time on the next think.
+ */
+UCLASS()
+class SHOOTER_API UEnemyBehaviorTreeComponent : public UBehaviorTreeComponent
+{
+	GENERATED_BODY()
+
+public:
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// 0 thinks on every tick
+	void SetThinkInterval(float Interval);
+
+	FORCEINLINE float GetThinkInterval() const { return ThinkInterval; }
+
+private:
+	float ThinkInterval = 0.f;
+
+	// time since the tree last ticked
+	float SkippedTime = 0.f;
+};
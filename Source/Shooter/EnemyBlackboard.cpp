@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyBlackboard.h"
+#include "AILODSubsystem.h"
+#include "EnemyController.h"
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blackboard writes"), STAT_BlackboardWrites, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blackboard writes unchanged"), STAT_BlackboardWritesUnchanged, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blackboard writes coalesced"), STAT_BlackboardWritesCoalesced, STATGROUP_Shooter);
+
+static const FName TargetKeyName(TEXT("Target"));
+static const FName CanAttackKeyName(TEXT("CanAttack"));
+static const FName StunnedKeyName(TEXT("Stunned"));
+static const FName InAttackRangeKeyName(TEXT("InAttackRange"));
+static const FName DeadKeyName(TEXT("Dead"));
+static const FName CharacterDeadKeyName(TEXT("CharacterDead"));
+static const FName PatrolPointKeyName(TEXT("PatrolPoint"));
+static const FName PatrolPoint2KeyName(TEXT("PatrolPoint2"));
+
+template <typename TDataClass>
+void FEnemyBlackboard::ResolveKey(TEnemyBlackboardKey<TDataClass>& Key, const FName& KeyName)
+{
+	Key.KeyID = Blackboard->GetKeyID(KeyName);
+	Key.bPending = false;
+
+	// a key of another type would be read and written as the wrong data
+	if (Key.KeyID != FBlackboard::InvalidKey && Blackboard->GetKeyType(Key.KeyID) != TDataClass::StaticClass())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Blackboard key %s is not a %s, it is ignored"), *KeyName.ToString(), *TDataClass::StaticClass()->GetName());
+		Key.KeyID = FBlackboard::InvalidKey;
+	}
+}
+
+template <typename TDataClass>
+void FEnemyBlackboard::SetValue(TEnemyBlackboardKey<TDataClass>& Key, typename TDataClass::FDataType Value)
+{
+	if (Key.KeyID == FBlackboard::InvalidKey)
+	{
+		return;
+	}
+
+	if (GetValue(Key) == Value)
+	{
+		INC_DWORD_STAT(STAT_BlackboardWritesUnchanged);
+		return;
+	}
+
+	if (Key.bPending)
+	{
+		INC_DWORD_STAT(STAT_BlackboardWritesCoalesced);
+	}
+	else
+	{
+		// the controller's tick can be throttled, the AI LOD subsystem flushes at the end of the frame
+		if (PendingCount == 0)
+		{
+			UWorld* World = Blackboard.IsValid() ? Blackboard->GetWorld() : nullptr;
+			UAILODSubsystem* AILOD = World ? World->GetSubsystem<UAILODSubsystem>() : nullptr;
+			if (AILOD)
+			{
+				AILOD->QueueBlackboardFlush(Cast<AEnemyController>(Blackboard->GetOwner()));
+			}
+		}
+
+		Key.bPending = true;
+		++PendingCount;
+	}
+	Key.PendingValue = Value;
+}
+
+template <typename TDataClass>
+void FEnemyBlackboard::FlushKey(TEnemyBlackboardKey<TDataClass>& Key)
+{
+	if (!Key.bPending)
+	{
+		return;
+	}
+
+	Key.bPending = false;
+	--PendingCount;
+
+	// observers are only notified when the value really changed since the last flush
+	if (Blackboard->SetValue<TDataClass>(Key.KeyID, Key.PendingValue))
+	{
+		INC_DWORD_STAT(STAT_BlackboardWrites);
+	}
+}
+
+void FEnemyBlackboard::Init(UBlackboardComponent* InBlackboard)
+{
+	Blackboard = InBlackboard;
+	PendingCount = 0;
+
+	if (InBlackboard == nullptr)
+	{
+		return;
+	}
+
+	ResolveKey(Target, TargetKeyName);
+	ResolveKey(CanAttack, CanAttackKeyName);
+	ResolveKey(Stunned, StunnedKeyName);
+	ResolveKey(InAttackRange, InAttackRangeKeyName);
+	ResolveKey(Dead, DeadKeyName);
+	ResolveKey(CharacterDead, CharacterDeadKeyName);
+	ResolveKey(PatrolPoint, PatrolPointKeyName);
+	ResolveKey(PatrolPoint2, PatrolPoint2KeyName);
+}
+
+void FEnemyBlackboard::Flush()
+{
+	if (PendingCount == 0)
+	{
+		return;
+	}
+
+	if (!Blackboard.IsValid())
+	{
+		PendingCount = 0;
+		return;
+	}
+
+	FlushKey(Target);
+	FlushKey(CanAttack);
+	FlushKey(Stunned);
+	FlushKey(InAttackRange);
+	FlushKey(Dead);
+	FlushKey(CharacterDead);
+	FlushKey(PatrolPoint);
+	FlushKey(PatrolPoint2);
+}
+
+void FEnemyBlackboard::SetTarget(UObject* Value)
+{
+	SetValue(Target, Value);
+}
+
+void FEnemyBlackboard::SetCanAttack(bool Value)
+{
+	SetValue(CanAttack, Value);
+}
+
+void FEnemyBlackboard::SetStunned(bool Value)
+{
+	SetValue(Stunned, Value);
+}
+
+void FEnemyBlackboard::SetInAttackRange(bool Value)
+{
+	SetValue(InAttackRange, Value);
+}
+
+void FEnemyBlackboard::SetDead(bool Value)
+{
+	SetValue(Dead, Value);
+}
+
+void FEnemyBlackboard::SetCharacterDead(bool Value)
+{
+	SetValue(CharacterDead, Value);
+}
+
+void FEnemyBlackboard::SetPatrolPoint(const FVector& Value)
+{
+	SetValue(PatrolPoint, Value);
+}
+
+void FEnemyBlackboard::SetPatrolPoint2(const FVector& Value)
+{
+	SetValue(PatrolPoint2, Value);
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Bool.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
+
+// one blackboard key, its id and the value waiting for the next flush
+template <typename TDataClass>
+struct TEnemyBlackboardKey
+{
+	FBlackboard::FKey KeyID = FBlackboard::InvalidKey;
+	typename TDataClass::FDataType PendingValue = typename TDataClass::FDataType();
+	bool bPending = false;
+};
+
+/**
+ * Typed access to the keys of the enemy blackboard. Key ids are resolved once when the
+ * controller possesses the enemy, writes that don't change the value are dropped and the
+ * rest are held until Flush, so several writes in a frame reach the observers once.
+ * Keys missing from the asset are ignored.
+ */
+class SHOOTER_API FEnemyBlackboard
+{
+public:
+	void Init(UBlackboardComponent* InBlackboard);
+
+	// writes every pending value
+	void Flush();
+
+	FORCEINLINE bool HasPendingWrites() const { return PendingCount > 0; }
+
+	FORCEINLINE UObject* GetTarget() const { return GetValue(Target); }
+	void SetTarget(UObject* Value);
+
+	FORCEINLINE bool GetCanAttack() const { return GetValue(CanAttack); }
+	void SetCanAttack(bool Value);
+
+	FORCEINLINE bool GetStunned() const { return GetValue(Stunned); }
+	void SetStunned(bool Value);
+
+	FORCEINLINE bool GetInAttackRange() const { return GetValue(InAttackRange); }
+	void SetInAttackRange(bool Value);
+
+	FORCEINLINE bool GetDead() const { return GetValue(Dead); }
+	void SetDead(bool Value);
+
+	FORCEINLINE bool GetCharacterDead() const { return GetValue(CharacterDead); }
+	void SetCharacterDead(bool Value);
+
+	FORCEINLINE FVector GetPatrolPoint() const { return GetValue(PatrolPoint); }
+	void SetPatrolPoint(const FVector& Value);
+
+	FORCEINLINE FVector GetPatrolPoint2() const { return GetValue(PatrolPoint2); }
+	void SetPatrolPoint2(const FVector& Value);
+
+private:
+	template <typename TDataClass>
+	typename TDataClass::FDataType GetValue(const TEnemyBlackboardKey<TDataClass>& Key) const
+	{
+		if (Key.bPending)
+		{
+			return Key.PendingValue;
+		}
+		return Blackboard.IsValid() && Key.KeyID != FBlackboard::InvalidKey
+			? Blackboard->GetValue<TDataClass>(Key.KeyID)
+			: typename TDataClass::FDataType();
+	}
+
+	template <typename TDataClass>
+	void SetValue(TEnemyBlackboardKey<TDataClass>& Key, typename TDataClass::FDataType Value);
+
+	template <typename TDataClass>
+	void FlushKey(TEnemyBlackboardKey<TDataClass>& Key);
+
+	template <typename TDataClass>
+	void ResolveKey(TEnemyBlackboardKey<TDataClass>& Key, const FName& KeyName);
+
+	TWeakObjectPtr<UBlackboardComponent> Blackboard;
+
+	TEnemyBlackboardKey<UBlackboardKeyType_Object> Target;
+	TEnemyBlackboardKey<UBlackboardKeyType_Bool> CanAttack;
+	TEnemyBlackboardKey<UBlackboardKeyType_Bool> Stunned;
+	TEnemyBlackboardKey<UBlackboardKeyType_Bool> InAttackRange;
+	TEnemyBlackboardKey<UBlackboardKeyType_Bool> Dead;
+	TEnemyBlackboardKey<UBlackboardKeyType_Bool> CharacterDead;
+	TEnemyBlackboardKey<UBlackboardKeyType_Vector> PatrolPoint;
+	TEnemyBlackboardKey<UBlackboardKeyType_Vector> PatrolPoint2;
+
+	int32 PendingCount = 0;
+};
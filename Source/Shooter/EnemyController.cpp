@@ -4,6 +4,7 @@
 #include "EnemyController.h"
 
 #include "Enemy.h"
+#include "EnemyBehaviorTreeComponent.h"
 #include "BehaviorTree/BehaviorTree.h"
 #include "BehaviorTree/BehaviorTreeComponent.h"
 #include "BehaviorTree/BlackboardComponent.h"
@@ -14,8 +15,11 @@ AEnemyController::AEnemyController()
 	BlacboardComponent = CreateDefaultSubobject<UBlackboardComponent>(TEXT("BlackboardComponent"));
 	check(BlacboardComponent);
 
-	BehaviorTreeComponent = CreateDefaultSubobject<UBehaviorTreeComponent>(TEXT("BehaviorTreeComponent"));
+	BehaviorTreeComponent = CreateDefaultSubobject<UEnemyBehaviorTreeComponent>(TEXT("BehaviorTreeComponent"));
 	check(BehaviorTreeComponent);
+
+	// RunBehaviorTree makes its own component unless the brain is already a behavior tree
+	BrainComponent = BehaviorTreeComponent;
 }
 
 void AEnemyController::OnPossess(APawn* InPawn)
@@ -35,4 +39,13 @@ void AEnemyController::OnPossess(APawn* InPawn)
 			BlacboardComponent->InitializeBlackboard(*(Enemy->GetBehaviorTree()->BlackboardAsset));
 		}
 	}
+
+	EnemyBlackboard.Init(BlacboardComponent);
+}
+
+void AEnemyController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	EnemyBlackboard.Flush();
 }
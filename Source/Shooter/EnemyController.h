@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "AIController.h"
+#include "EnemyBlackboard.h"
 #include "EnemyController.generated.h"
 
 /**
@@ -17,6 +18,9 @@ class SHOOTER_API AEnemyController : public AAIController
 public:
 	AEnemyController();
 
+	// blackboard writes of the last frame go out here, the AI LOD subsystem flushes the rest at the end of the frame
+	virtual void Tick(float DeltaTime) override;
+
 protected:
 	virtual void OnPossess(APawn* InPawn) override;
 
@@ -27,8 +31,14 @@ private:
 	UPROPERTY(BlueprintReadWrite, Category = "AI Behavior", meta = (AllowPrivateAccess = "true"))
 	class UBehaviorTreeComponent* BehaviorTreeComponent;
 
+	FEnemyBlackboard EnemyBlackboard;
+
 public:
 
 	FORCEINLINE UBlackboardComponent* GetBlacboardCompomponent() const { return  BlacboardComponent; }
 
+	// key ids resolved on possess, writes are batched until the end of the frame
+	FORCEINLINE FEnemyBlackboard& GetEnemyBlackboard() { return EnemyBlackboard; }
+	FORCEINLINE const FEnemyBlackboard& GetEnemyBlackboard() const { return EnemyBlackboard; }
+
 };
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyPoolSubsystem.h"
+#include "Enemy.h"
+#include "Kismet/GameplayStatics.h"
+#include "EngineUtils.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy spawn"), STAT_EnemySpawn, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemies spawned"), STAT_EnemiesSpawned, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemies reused"), STAT_EnemiesReused, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarEnemyPoolMax(
+	TEXT("shooter.EnemyPoolMax"),
+	64,
+	TEXT("Most dead enemies kept per class, more are destroyed."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs EnemySpawnBenchmarkCommand(
+	TEXT("shooter.EnemySpawnBenchmark"),
+	TEXT("Spawns copies of the first enemy as new actors, pools them, spawns them again from the pool\n")
+	TEXT("and logs the average and worst cost of one spawn for both.\n")
+	TEXT("shooter.EnemySpawnBenchmark [EnemyCount=20]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 EnemyCount = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 20, 1);
+
+		UEnemyPoolSubsystem* EnemyPool = World ? World->GetSubsystem<UEnemyPoolSubsystem>() : nullptr;
+		if (EnemyPool == nullptr)
+		{
+			return;
+		}
+
+		TActorIterator<AEnemy> It(World);
+		if (!It)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("EnemySpawnBenchmark: needs at least one enemy in the level"));
+			return;
+		}
+
+		UClass* EnemyClass = It->GetClass();
+		const FVector Origin = It->GetActorLocation();
+
+		TArray<AEnemy*> Enemies;
+		auto TimeSpawns = [&](bool bUsePool, double& OutMaxMs)
+		{
+			OutMaxMs = 0.0;
+			double TotalMs = 0.0;
+			for (int32 Index = 0; Index < EnemyCount; ++Index)
+			{
+				const FTransform Transform(Origin + FVector((Index % 10) * 400.f, (Index / 10 + 1) * 400.f, 0.f));
+
+				const double StartTime = FPlatformTime::Seconds();
+				AEnemy* Enemy = bUsePool ? EnemyPool->SpawnEnemy(EnemyClass, Transform) : EnemyPool->SpawnNewEnemy(EnemyClass, Transform);
+				const double SpawnMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+				TotalMs += SpawnMs;
+				OutMaxMs = FMath::Max(OutMaxMs, SpawnMs);
+				if (Enemy)
+				{
+					Enemies.Add(Enemy);
+				}
+			}
+			return TotalMs / EnemyCount;
+		};
+
+		double NewMaxMs;
+		const double NewMs = TimeSpawns(false, NewMaxMs);
+
+		for (AEnemy* Enemy : Enemies)
+		{
+			if (!EnemyPool->ReleaseEnemy(Enemy))
+			{
+				Enemy->Destroy();
+			}
+		}
+		Enemies.Reset();
+
+		double PooledMaxMs;
+		const double PooledMs = TimeSpawns(true, PooledMaxMs);
+
+		UE_LOG(LogTemp, Log, TEXT("EnemySpawnBenchmark: %d enemies - new actor %.3f ms (worst %.3f), from pool %.3f ms (worst %.3f) per spawn"),
+			EnemyCount, NewMs, NewMaxMs, PooledMs, PooledMaxMs);
+
+		for (AEnemy* Enemy : Enemies)
+		{
+			Enemy->Destroy();
+		}
+	}));
+
+void UEnemyPoolSubsystem::Deinitialize()
+{
+	// the actors go with the world
+	Pools.Reset();
+
+	Super::Deinitialize();
+}
+
+FEnemyPool& UEnemyPoolSubsystem::FindOrAddPool(UClass* EnemyClass)
+{
+	FEnemyPool* Pool = Pools.FindByPredicate([EnemyClass](const FEnemyPool& Other) { return Other.EnemyClass == EnemyClass; });
+	if (Pool)
+	{
+		return *Pool;
+	}
+
+	FEnemyPool& NewPool = Pools.AddDefaulted_GetRef();
+	NewPool.EnemyClass = EnemyClass;
+	return NewPool;
+}
+
+AEnemy* UEnemyPoolSubsystem::SpawnEnemy(TSubclassOf<AEnemy> EnemyClass, const FTransform& Transform)
+{
+	if (EnemyClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_EnemySpawn);
+
+	FEnemyPool& Pool = FindOrAddPool(EnemyClass);
+	while (Pool.Inactive.Num() > 0)
+	{
+		// entries are nulled if the actor was destroyed while pooled
+		AEnemy* Enemy = Pool.Inactive.Pop(false);
+		if (Enemy && !Enemy->IsPendingKill())
+		{
+			Enemy->ActivateFromPool(Transform);
+			INC_DWORD_STAT(STAT_EnemiesReused);
+			return Enemy;
+		}
+	}
+
+	return SpawnNewEnemy(EnemyClass, Transform);
+}
+
+AEnemy* UEnemyPoolSubsystem::SpawnNewEnemy(TSubclassOf<AEnemy> EnemyClass, const FTransform& Transform)
+{
+	AEnemy* Enemy = GetWorld()->SpawnActorDeferred<AEnemy>(EnemyClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (Enemy)
+	{
+		// spawned enemies need a controller to run their behavior tree
+		Enemy->AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
+		UGameplayStatics::FinishSpawningActor(Enemy, Transform);
+		INC_DWORD_STAT(STAT_EnemiesSpawned);
+	}
+	return Enemy;
+}
+
+bool UEnemyPoolSubsystem::ReleaseEnemy(AEnemy* Enemy)
+{
+	if (Enemy == nullptr || Enemy->IsPendingKill())
+	{
+		return false;
+	}
+
+	FEnemyPool& Pool = FindOrAddPool(Enemy->GetClass());
+	if (Pool.Inactive.Num() >= CVarEnemyPoolMax.GetValueOnGameThread())
+	{
+		return false;
+	}
+
+	Enemy->DeactivateForPool();
+	Pool.Inactive.Add(Enemy);
+	return true;
+}
+
+void UEnemyPoolSubsystem::Prewarm(TSubclassOf<AEnemy> EnemyClass, int32 Count)
+{
+	if (EnemyClass == nullptr)
+	{
+		return;
+	}
+
+	for (int32 Index = GetPooledCount(EnemyClass); Index < Count; ++Index)
+	{
+		AEnemy* Enemy = SpawnNewEnemy(EnemyClass, FTransform::Identity);
+		if (Enemy && !ReleaseEnemy(Enemy))
+		{
+			Enemy->Destroy();
+			break;
+		}
+	}
+}
+
+int32 UEnemyPoolSubsystem::GetPooledCount(TSubclassOf<AEnemy> EnemyClass) const
+{
+	const FEnemyPool* Pool = Pools.FindByPredicate([&EnemyClass](const FEnemyPool& Other) { return Other.EnemyClass == EnemyClass.Get(); });
+	return Pool ? Pool->Inactive.Num() : 0;
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyPoolSubsystem.generated.h"
+
+class AEnemy;
+
+// dead enemies of one class waiting to be respawned
+USTRUCT()
+struct FEnemyPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UClass* EnemyClass = nullptr;
+
+	UPROPERTY()
+	TArray<AEnemy*> Inactive;
+};
+
+/**
+ * Keeps dead enemies hidden and inert instead of destroying them. Spawning takes a pooled
+ * enemy of the class first and only resets it, a new actor is spawned when the pool is empty.
+ */
+UCLASS()
+class SHOOTER_API UEnemyPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	AEnemy* SpawnEnemy(TSubclassOf<AEnemy> EnemyClass, const FTransform& Transform);
+
+	// false when the pool is full, the caller destroys the enemy then
+	bool ReleaseEnemy(AEnemy* Enemy);
+
+	// spawns Count enemies straight into the pool
+	void Prewarm(TSubclassOf<AEnemy> EnemyClass, int32 Count);
+
+	int32 GetPooledCount(TSubclassOf<AEnemy> EnemyClass) const;
+
+	// always a new actor, bypasses the pool
+	AEnemy* SpawnNewEnemy(TSubclassOf<AEnemy> EnemyClass, const FTransform& Transform);
+
+private:
+	FEnemyPool& FindOrAddPool(UClass* EnemyClass);
+
+	UPROPERTY()
+	TArray<FEnemyPool> Pools;
+};
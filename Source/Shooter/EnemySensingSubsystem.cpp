@@ -0,0 +1,247 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemySensingSubsystem.h"
+#include "Enemy.h"
+#include "ShooterCharacter.h"
+#include "GameFramework/PlayerController.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy sensing"), STAT_EnemySensing, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemies sensed"), STAT_EnemiesSensed, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<float> CVarSensingInterval(
+	TEXT("shooter.SensingInterval"),
+	0.1f,
+	TEXT("Seconds between two sensing passes over all enemies."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarSensingCellSize(
+	TEXT("shooter.SensingCellSize"),
+	1000.f,
+	TEXT("Cell size of the enemy spatial hash, about the largest agro radius works best."),
+	ECVF_Default);
+
+static FAutoConsoleCommand SensingBenchmarkCommand(
+	TEXT("shooter.SensingBenchmark"),
+	TEXT("Senses 10 to 2000 enemies around 4 players without a world and logs the cost per pass and per enemy.\n")
+	TEXT("shooter.SensingBenchmark [PassCount=200]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 PassCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 200;
+		UEnemySensingSubsystem::RunBenchmark(PassCount);
+	}));
+
+void FSensingGrid::Update()
+{
+	const int32 NumEnemies = EnemyLocations.Num();
+
+	// about two buckets per enemy keeps the chains short
+	const int32 NumBuckets = FMath::RoundUpToPowerOfTwo(FMath::Max(NumEnemies * 2, 64));
+	BucketHeads.Init(INDEX_NONE, NumBuckets);
+	NextInBucket.SetNumUninitialized(NumEnemies, false);
+	EnemyCells.SetNumUninitialized(NumEnemies, false);
+
+	float MaxRadius = 0.f;
+	for (int32 Index = 0; Index < NumEnemies; ++Index)
+	{
+		const FIntVector Cell = GetCell(EnemyLocations[Index]);
+		const int32 Bucket = GetBucket(Cell);
+		EnemyCells[Index] = Cell;
+		NextInBucket[Index] = BucketHeads[Bucket];
+		BucketHeads[Bucket] = Index;
+
+		MaxRadius = FMath::Max3(MaxRadius, AgroRadii[Index], CombatRadii[Index]);
+	}
+
+	AgroPlayers.Init(INDEX_NONE, NumEnemies);
+	CombatPlayers.Init(INDEX_NONE, NumEnemies);
+	AgroDistances.Init(BIG_NUMBER, NumEnemies);
+	CombatDistances.Init(BIG_NUMBER, NumEnemies);
+
+	const FVector Extent(MaxRadius);
+	for (int32 PlayerIndex = 0; PlayerIndex < PlayerLocations.Num(); ++PlayerIndex)
+	{
+		const FVector& PlayerLocation = PlayerLocations[PlayerIndex];
+		const FIntVector MinCell = GetCell(PlayerLocation - Extent);
+		const FIntVector MaxCell = GetCell(PlayerLocation + Extent);
+
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+			{
+				for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+				{
+					const FIntVector Cell(X, Y, Z);
+					for (int32 Index = BucketHeads[GetBucket(Cell)]; Index != INDEX_NONE; Index = NextInBucket[Index])
+					{
+						// other cells can share the bucket
+						if (EnemyCells[Index] != Cell)
+						{
+							continue;
+						}
+
+						const float DistanceSquared = FVector::DistSquared(PlayerLocation, EnemyLocations[Index]);
+						if (DistanceSquared <= FMath::Square(AgroRadii[Index]) && DistanceSquared < AgroDistances[Index])
+						{
+							AgroDistances[Index] = DistanceSquared;
+							AgroPlayers[Index] = PlayerIndex;
+						}
+						if (DistanceSquared <= FMath::Square(CombatRadii[Index]) && DistanceSquared < CombatDistances[Index])
+						{
+							CombatDistances[Index] = DistanceSquared;
+							CombatPlayers[Index] = PlayerIndex;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void UEnemySensingSubsystem::RegisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy && !Enemies.Contains(Enemy))
+	{
+		Enemies.Add(Enemy);
+		EnemiesInAgroRange.Add(false);
+		EnemiesInCombatRange.Add(false);
+	}
+}
+
+void UEnemySensingSubsystem::UnregisterEnemy(AEnemy* Enemy)
+{
+	const int32 Index = Enemies.IndexOfByKey(Enemy);
+	if (Index != INDEX_NONE)
+	{
+		RemoveEnemy(Index);
+	}
+}
+
+void UEnemySensingSubsystem::RemoveEnemy(int32 Index)
+{
+	Enemies.RemoveAtSwap(Index, 1, false);
+	EnemiesInAgroRange.RemoveAtSwap(Index, 1, false);
+	EnemiesInCombatRange.RemoveAtSwap(Index, 1, false);
+}
+
+void UEnemySensingSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceSense += DeltaTime;
+	if (TimeSinceSense < CVarSensingInterval.GetValueOnGameThread())
+	{
+		return;
+	}
+	TimeSinceSense = 0.f;
+
+	Sense();
+}
+
+void UEnemySensingSubsystem::Sense()
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemySensing);
+
+	// going backwards, the enemy swapped in from the end was already checked
+	for (int32 Index = Enemies.Num() - 1; Index >= 0; --Index)
+	{
+		if (!Enemies[Index].IsValid())
+		{
+			RemoveEnemy(Index);
+		}
+	}
+
+	Players.Reset();
+	Grid.PlayerLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		AShooterCharacter* Player = It->Get() ? Cast<AShooterCharacter>(It->Get()->GetPawn()) : nullptr;
+		if (Player)
+		{
+			Players.Add(Player);
+			Grid.PlayerLocations.Add(Player->GetActorLocation());
+		}
+	}
+
+	Grid.CellSize = FMath::Max(CVarSensingCellSize.GetValueOnGameThread(), 100.f);
+	Grid.EnemyLocations.Reset(Enemies.Num());
+	Grid.AgroRadii.Reset(Enemies.Num());
+	Grid.CombatRadii.Reset(Enemies.Num());
+	for (const TWeakObjectPtr<AEnemy>& Enemy : Enemies)
+	{
+		Grid.EnemyLocations.Add(Enemy->GetActorLocation());
+		Grid.AgroRadii.Add(Enemy->GetAgroRadius());
+		Grid.CombatRadii.Add(Enemy->GetCombatRangeRadius());
+	}
+
+	Grid.Update();
+
+	// the enemies only hear about changes, like the overlap events they replace
+	for (int32 Index = 0; Index < Enemies.Num(); ++Index)
+	{
+		AEnemy* Enemy = Enemies[Index].Get();
+
+		const int32 AgroPlayer = Grid.AgroPlayers[Index];
+		if (AgroPlayer != INDEX_NONE && !EnemiesInAgroRange[Index])
+		{
+			Enemy->OnPlayerEnteredAgroRange(Players[AgroPlayer]);
+		}
+		EnemiesInAgroRange[Index] = AgroPlayer != INDEX_NONE;
+
+		const bool bInCombatRange = Grid.CombatPlayers[Index] != INDEX_NONE;
+		if (bInCombatRange != EnemiesInCombatRange[Index])
+		{
+			EnemiesInCombatRange[Index] = bInCombatRange;
+			Enemy->SetInAttackRange(bInCombatRange);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_EnemiesSensed, Enemies.Num());
+}
+
+void UEnemySensingSubsystem::RunBenchmark(int32 PassCount)
+{
+	PassCount = FMath::Max(PassCount, 1);
+
+	static const int32 EnemyCounts[] = { 10, 100, 500, 1000, 2000 };
+	for (const int32 EnemyCount : EnemyCounts)
+	{
+		// same density at every count, so only the number of enemies changes
+		const float HalfSize = FMath::Sqrt(static_cast<float>(EnemyCount)) * 300.f;
+		FRandomStream RandomStream(EnemyCount);
+
+		FSensingGrid BenchmarkGrid;
+		for (int32 Index = 0; Index < EnemyCount; ++Index)
+		{
+			BenchmarkGrid.EnemyLocations.Add(FVector(RandomStream.FRandRange(-HalfSize, HalfSize), RandomStream.FRandRange(-HalfSize, HalfSize), 0.f));
+			BenchmarkGrid.AgroRadii.Add(1000.f);
+			BenchmarkGrid.CombatRadii.Add(150.f);
+		}
+		for (int32 Index = 0; Index < 4; ++Index)
+		{
+			BenchmarkGrid.PlayerLocations.Add(FVector(RandomStream.FRandRange(-HalfSize, HalfSize), RandomStream.FRandRange(-HalfSize, HalfSize), 0.f));
+		}
+
+		// first pass sizes the arrays
+		BenchmarkGrid.Update();
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Pass = 0; Pass < PassCount; ++Pass)
+		{
+			BenchmarkGrid.Update();
+		}
+		const double PassMicroseconds = (FPlatformTime::Seconds() - StartTime) * 1.0e6 / PassCount;
+
+		UE_LOG(LogTemp, Log, TEXT("Sensing benchmark: %d enemies, %.2f us per pass, %.1f ns per enemy"),
+			EnemyCount, PassMicroseconds, PassMicroseconds * 1000.0 / EnemyCount);
+	}
+}
+
+ETickableTickType UEnemySensingSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UEnemySensingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemySensingSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "EnemySensingSubsystem.generated.h"
+
+class AEnemy;
+class AShooterCharacter;
+
+/**
+ * Finds the players inside every enemy's agro and combat radius. Enemies go into a uniform
+ * spatial hash, linked lists through flat arrays so rebuilding it doesn't allocate, and each
+ * player only visits the cells within the largest radius around it.
+ * Plain struct so it can run without a world (benchmark).
+ */
+struct FSensingGrid
+{
+	float CellSize = 1000.f;
+
+	TArray<FVector> EnemyLocations;
+	TArray<float> AgroRadii;
+	TArray<float> CombatRadii;
+	TArray<FVector> PlayerLocations;
+
+	// nearest player inside each enemy's radius, INDEX_NONE when there is none
+	TArray<int32> AgroPlayers;
+	TArray<int32> CombatPlayers;
+
+	void Update();
+
+private:
+	FORCEINLINE FIntVector GetCell(const FVector& Location) const
+	{
+		return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+	}
+
+	FORCEINLINE int32 GetBucket(const FIntVector& Cell) const
+	{
+		const uint32 Hash = (static_cast<uint32>(Cell.X) * 73856093u) ^ (static_cast<uint32>(Cell.Y) * 19349663u) ^ (static_cast<uint32>(Cell.Z) * 83492791u);
+		return static_cast<int32>(Hash & static_cast<uint32>(BucketHeads.Num() - 1));
+	}
+
+	TArray<FIntVector> EnemyCells;
+	TArray<int32> BucketHeads;
+	TArray<int32> NextInBucket;
+	TArray<float> AgroDistances;
+	TArray<float> CombatDistances;
+};
+
+/**
+ * Replaces the agro and combat range sphere components of the enemies. At a fixed rate all
+ * registered enemies are sensed in one pass, and enemies are told when a player comes into
+ * agro range and when players enter or leave their attack range.
+ */
+UCLASS()
+class SHOOTER_API UEnemySensingSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterEnemy(AEnemy* Enemy);
+	void UnregisterEnemy(AEnemy* Enemy);
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return Enemies.Num() > 0; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+	// senses 10 to 2000 enemies PassCount times each without a world and logs the cost per enemy
+	static void RunBenchmark(int32 PassCount);
+
+private:
+	void Sense();
+	void RemoveEnemy(int32 Index);
+
+	TArray<TWeakObjectPtr<AEnemy>> Enemies;
+
+	// state after the last pass, transitions are sent against it
+	TArray<bool> EnemiesInAgroRange;
+	TArray<bool> EnemiesInCombatRange;
+
+	// reused every pass
+	TArray<AShooterCharacter*> Players;
+
+	FSensingGrid Grid;
+
+	float TimeSinceSense = 0.f;
+};
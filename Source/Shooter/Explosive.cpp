@@ -7,6 +7,9 @@
 #include "GameFramework/Character.h"
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
+#include "CombatResolutionSubsystem.h"
+#include "FXPoolSubsystem.h"
+#include "AudioEventSubsystem.h"
 
 // Sets default values
 AExplosive::AExplosive() :
@@ -36,26 +39,48 @@ void AExplosive::Tick(float DeltaTime)
 
 }
 
-void AExplosive::BulletHit_Implementation(FHitResult HitResult, AActor* Shooter, AController* ShooterContorller)
+void AExplosive::BulletHit_Implementation(const FHitResult& HitResult, AActor* Shooter, AController* ShooterContorller)
 {
+	Explode(HitResult.Location, Shooter, ShooterContorller);
+}
+
+void AExplosive::BulletHitBatch(const FBulletHitBatch& Batch)
+{
+	Explode(Batch.GetFirstHit().Location, Batch.Shooter, Batch.ShooterController);
+}
+
+void AExplosive::Explode(const FVector& HitLocation, AActor* Shooter, AController* ShooterController)
+{
+	if (IsPendingKill())
+	{
+		// already went off this frame
+		return;
+	}
+
 	if (ImpactSound)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
+		UAudioEventSubsystem::PlaySoundAtLocation(this, EAudioEventCategory::EAEC_Explosion, ImpactSound, GetActorLocation());
 	}
 
 	if (ExplodeParticles)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplodeParticles, HitResult.Location, FRotator(0.f), true);
+		// explosions are seen from far away
+		UFXPoolSubsystem::SpawnFXAtLocation(this, ExplodeParticles, FTransform(HitLocation), false);
 	}
 
 	// Apply explosive damage
 	TArray<AActor*> OverlappingActors;
 	GetOverlappingActors(OverlappingActors, ACharacter::StaticClass());
 
+	// damage goes through the combat resolution so it is merged with the frame's bullet hits
+	UCombatResolutionSubsystem* CombatResolution = GetWorld()->GetSubsystem<UCombatResolutionSubsystem>();
 	for (AActor* Actor : OverlappingActors)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Actor damaged by explosive: %s"), *Actor->GetName());
-		UGameplayStatics::ApplyDamage(Actor, Damage, ShooterContorller, Shooter, UDamageType::StaticClass());
+		if (CombatResolution)
+		{
+			CombatResolution->QueueDamage(Actor, Damage, Shooter, ShooterController);
+		}
 	}
 
 	Destroy();
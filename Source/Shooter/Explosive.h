@@ -41,5 +41,10 @@ private:
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
-	virtual void BulletHit_Implementation(FHitResult HitResult, AActor* Shooter, AController* ShooterContorller) override;
+	virtual void BulletHit_Implementation(const FHitResult& HitResult, AActor* Shooter, AController* ShooterContorller) override;
+	virtual void BulletHitBatch(const FBulletHitBatch& Batch) override;
+
+private:
+	// explodes once no matter how many bullets hit it this frame
+	void Explode(const FVector& HitLocation, AActor* Shooter, AController* ShooterController);
 };
@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FXPoolSubsystem.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX spawned"), STAT_FXSpawned, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX rejected by distance"), STAT_FXRejected, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX recycled at cap"), STAT_FXRecycled, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("FX components created"), STAT_FXComponentsCreated, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarFXPoolMaxPerTemplate(
+	TEXT("shooter.FXPoolMaxPerTemplate"),
+	32,
+	TEXT("Most pooled components per particle template, the oldest effect is recycled past this."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFXPoolPrewarm(
+	TEXT("shooter.FXPoolPrewarm"),
+	4,
+	TEXT("Components created for a template the first time it is spawned."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFXCullDistance(
+	TEXT("shooter.FXCullDistance"),
+	10000.f,
+	TEXT("Effects further than this from the camera are not spawned, 0 spawns everything."),
+	ECVF_Default);
+
+static int32 GetMaxPerTemplate()
+{
+	return FMath::Max(CVarFXPoolMaxPerTemplate.GetValueOnGameThread(), 1);
+}
+
+void UFXPoolSubsystem::Deinitialize()
+{
+	for (FFXPool& Pool : Pools)
+	{
+		for (UParticleSystemComponent* Component : Pool.Components)
+		{
+			if (Component)
+			{
+				Component->DestroyComponent();
+			}
+		}
+	}
+
+	Pools.Reset();
+	PoolIndices.Reset();
+	ActiveCount = 0;
+
+	Super::Deinitialize();
+}
+
+FFXHandle UFXPoolSubsystem::SpawnFX(UParticleSystem* Template, const FTransform& Transform, bool bCullByDistance)
+{
+	if (Template == nullptr || GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return FFXHandle();
+	}
+
+	if (bCullByDistance && IsTooFarFromCamera(Transform.GetLocation()))
+	{
+		INC_DWORD_STAT(STAT_FXRejected);
+		return FFXHandle();
+	}
+
+	const int32 PoolIndex = FindOrAddPool(Template);
+	FFXPool& Pool = Pools[PoolIndex];
+	const int32 SlotIndex = AcquireSlot(Pool);
+
+	UParticleSystemComponent* Component = Pool.Components[SlotIndex];
+	Component->SetWorldTransform(Transform);
+	// reset so a recycled component starts the effect from the beginning
+	Component->ActivateSystem(true);
+
+	INC_DWORD_STAT(STAT_FXSpawned);
+
+	FFXHandle Handle;
+	Handle.PoolIndex = PoolIndex;
+	Handle.SlotIndex = SlotIndex;
+	Handle.Generation = Pool.Generations[SlotIndex];
+	return Handle;
+}
+
+FFXHandle UFXPoolSubsystem::SpawnFX(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation, bool bCullByDistance)
+{
+	return SpawnFX(Template, FTransform(Rotation, Location), bCullByDistance);
+}
+
+FFXHandle UFXPoolSubsystem::SpawnFXAtLocation(const UObject* WorldContextObject, UParticleSystem* Template, const FTransform& Transform, bool bCullByDistance)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UFXPoolSubsystem* FXPool = World ? World->GetSubsystem<UFXPoolSubsystem>() : nullptr;
+	return FXPool ? FXPool->SpawnFX(Template, Transform, bCullByDistance) : FFXHandle();
+}
+
+void UFXPoolSubsystem::Prewarm(UParticleSystem* Template, int32 Count)
+{
+	if (Template == nullptr)
+	{
+		return;
+	}
+
+	FFXPool& Pool = Pools[FindOrAddPool(Template)];
+	Count = FMath::Min(Count, GetMaxPerTemplate());
+	while (Pool.Components.Num() < Count)
+	{
+		Pool.FreeSlots.Add(AddComponent(Pool));
+	}
+}
+
+bool UFXPoolSubsystem::IsActive(const FFXHandle& Handle) const
+{
+	return GetComponent(Handle) != nullptr;
+}
+
+void UFXPoolSubsystem::SetVectorParameter(const FFXHandle& Handle, FName ParameterName, const FVector& Value)
+{
+	UParticleSystemComponent* Component = GetComponent(Handle);
+	if (Component)
+	{
+		Component->SetVectorParameter(ParameterName, Value);
+	}
+}
+
+void UFXPoolSubsystem::Stop(const FFXHandle& Handle)
+{
+	UParticleSystemComponent* Component = GetComponent(Handle);
+	if (Component)
+	{
+		Component->DeactivateSystem();
+	}
+}
+
+void UFXPoolSubsystem::Tick(float DeltaTime)
+{
+	// finished effects go back to the free list
+	for (FFXPool& Pool : Pools)
+	{
+		for (int32 Index = Pool.ActiveSlots.Num() - 1; Index >= 0; --Index)
+		{
+			const int32 SlotIndex = Pool.ActiveSlots[Index];
+			UParticleSystemComponent* Component = Pool.Components[SlotIndex];
+			if (Component && Component->IsActive())
+			{
+				continue;
+			}
+
+			Pool.ActiveSlots.RemoveAtSwap(Index, 1, false);
+			Pool.FreeSlots.Add(SlotIndex);
+			--ActiveCount;
+		}
+	}
+}
+
+ETickableTickType UFXPoolSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UFXPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFXPoolSubsystem, STATGROUP_Tickables);
+}
+
+int32 UFXPoolSubsystem::FindOrAddPool(UParticleSystem* Template)
+{
+	if (const int32* PoolIndex = PoolIndices.Find(Template))
+	{
+		return *PoolIndex;
+	}
+
+	const int32 PoolIndex = Pools.AddDefaulted();
+	PoolIndices.Add(Template, PoolIndex);
+
+	FFXPool& Pool = Pools[PoolIndex];
+	Pool.Template = Template;
+
+	const int32 PrewarmCount = FMath::Min(CVarFXPoolPrewarm.GetValueOnGameThread(), GetMaxPerTemplate());
+	for (int32 Index = 0; Index < PrewarmCount; ++Index)
+	{
+		Pool.FreeSlots.Add(AddComponent(Pool));
+	}
+
+	return PoolIndex;
+}
+
+int32 UFXPoolSubsystem::AddComponent(FFXPool& Pool)
+{
+	UWorld* World = GetWorld();
+
+	UParticleSystemComponent* Component = NewObject<UParticleSystemComponent>(World);
+	Component->bAutoDestroy = false;
+	Component->bAutoActivate = false;
+	Component->SetAbsolute(true, true, true);
+	Component->SetTemplate(Pool.Template);
+	Component->RegisterComponentWithWorld(World);
+
+	INC_DWORD_STAT(STAT_FXComponentsCreated);
+
+	Pool.Generations.Add(0);
+	Pool.SpawnTimes.Add(0.f);
+	return Pool.Components.Add(Component);
+}
+
+int32 UFXPoolSubsystem::AcquireSlot(FFXPool& Pool)
+{
+	int32 SlotIndex = INDEX_NONE;
+
+	if (Pool.FreeSlots.Num() > 0)
+	{
+		SlotIndex = Pool.FreeSlots.Pop(false);
+	}
+	else if (Pool.Components.Num() < GetMaxPerTemplate())
+	{
+		SlotIndex = AddComponent(Pool);
+	}
+	else
+	{
+		// at the cap - recycle the oldest effect, it stays in the active list
+		int32 OldestIndex = 0;
+		for (int32 Index = 1; Index < Pool.ActiveSlots.Num(); ++Index)
+		{
+			if (Pool.SpawnTimes[Pool.ActiveSlots[Index]] < Pool.SpawnTimes[Pool.ActiveSlots[OldestIndex]])
+			{
+				OldestIndex = Index;
+			}
+		}
+
+		INC_DWORD_STAT(STAT_FXRecycled);
+
+		SlotIndex = Pool.ActiveSlots[OldestIndex];
+		++Pool.Generations[SlotIndex];
+		Pool.SpawnTimes[SlotIndex] = GetWorld()->GetTimeSeconds();
+		return SlotIndex;
+	}
+
+	Pool.ActiveSlots.Add(SlotIndex);
+	++ActiveCount;
+
+	++Pool.Generations[SlotIndex];
+	Pool.SpawnTimes[SlotIndex] = GetWorld()->GetTimeSeconds();
+	return SlotIndex;
+}
+
+UParticleSystemComponent* UFXPoolSubsystem::GetComponent(const FFXHandle& Handle) const
+{
+	if (!Pools.IsValidIndex(Handle.PoolIndex))
+	{
+		return nullptr;
+	}
+
+	const FFXPool& Pool = Pools[Handle.PoolIndex];
+	if (!Pool.Components.IsValidIndex(Handle.SlotIndex) || Pool.Generations[Handle.SlotIndex] != Handle.Generation)
+	{
+		return nullptr;
+	}
+
+	UParticleSystemComponent* Component = Pool.Components[Handle.SlotIndex];
+	return Component && Component->IsActive() ? Component : nullptr;
+}
+
+bool UFXPoolSubsystem::IsTooFarFromCamera(const FVector& Location) const
+{
+	const float CullDistance = CVarFXCullDistance.GetValueOnGameThread();
+	if (CullDistance <= 0.f)
+	{
+		return false;
+	}
+
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController == nullptr || PlayerController->PlayerCameraManager == nullptr)
+	{
+		return false;
+	}
+
+	return FVector::DistSquared(PlayerController->PlayerCameraManager->GetCameraLocation(), Location) > FMath::Square(CullDistance);
+}
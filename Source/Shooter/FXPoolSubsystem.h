@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "FXPoolSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+
+// refers to one use of a pooled component, goes stale when the component is recycled
+struct FFXHandle
+{
+	int32 PoolIndex = INDEX_NONE;
+	int32 SlotIndex = INDEX_NONE;
+	uint32 Generation = 0;
+
+	FORCEINLINE bool IsSet() const { return PoolIndex != INDEX_NONE; }
+};
+
+// components of one template, a slot is free when its component is not active
+USTRUCT()
+struct FFXPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UParticleSystem* Template = nullptr;
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Components;
+
+	// bumped every time the slot is handed out
+	TArray<uint32> Generations;
+	TArray<float> SpawnTimes;
+
+	TArray<int32> FreeSlots;
+	TArray<int32> ActiveSlots;
+};
+
+/**
+ * Pre-warms and recycles particle system components per template, instead of spawning
+ * and garbage collecting a component for every muzzle flash, beam, impact and blood hit.
+ * When a template is at its cap the oldest effect is recycled, effects far from the camera are not spawned.
+ */
+UCLASS()
+class SHOOTER_API UFXPoolSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// unset handle when the effect was rejected
+	FFXHandle SpawnFX(UParticleSystem* Template, const FTransform& Transform, bool bCullByDistance = true);
+	FFXHandle SpawnFX(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation = FRotator::ZeroRotator, bool bCullByDistance = true);
+
+	// shorthand for the subsystem of the context object's world
+	static FFXHandle SpawnFXAtLocation(const UObject* WorldContextObject, UParticleSystem* Template, const FTransform& Transform, bool bCullByDistance = true);
+
+	// creates components up front so the first shots do not create them, at least shooter.FXPoolPrewarm of them
+	void Prewarm(UParticleSystem* Template, int32 Count = 0);
+
+	bool IsActive(const FFXHandle& Handle) const;
+	void SetVectorParameter(const FFXHandle& Handle, FName ParameterName, const FVector& Value);
+	// lets the effect finish, the slot is freed when the component deactivates
+	void Stop(const FFXHandle& Handle);
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return ActiveCount > 0; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+private:
+	int32 FindOrAddPool(UParticleSystem* Template);
+	int32 AddComponent(FFXPool& Pool);
+	int32 AcquireSlot(FFXPool& Pool);
+	UParticleSystemComponent* GetComponent(const FFXHandle& Handle) const;
+	bool IsTooFarFromCamera(const FVector& Location) const;
+
+	UPROPERTY()
+	TArray<FFXPool> Pools;
+
+	TMap<UParticleSystem*, int32> PoolIndices;
+
+	int32 ActiveCount = 0;
+};
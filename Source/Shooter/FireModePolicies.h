@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Weapon.h"
+
+// Fire behaviour is put together from these policies when a weapon is equipped (AShooterCharacter::BindFireMode),
+// the fire schedule then calls one pre-bound function per shot with no weapon type checks.
+
+// trigger policies - whether the schedule keeps firing after ShotsFired shots of the current trigger pull
+
+struct FSemiAutoTrigger
+{
+	static FORCEINLINE bool ShouldContinue(const AWeapon* Weapon, bool bTriggerHeld, int32 ShotsFired) { return false; }
+};
+
+struct FAutomaticTrigger
+{
+	static FORCEINLINE bool ShouldContinue(const AWeapon* Weapon, bool bTriggerHeld, int32 ShotsFired) { return bTriggerHeld; }
+};
+
+// whole burst fires even if the trigger is released
+struct FBurstTrigger
+{
+	static FORCEINLINE bool ShouldContinue(const AWeapon* Weapon, bool bTriggerHeld, int32 ShotsFired) { return ShotsFired < Weapon->GetBurstCount(); }
+};
+
+// slide / recoil policies - what the weapon does after every shot
+
+struct FNoSlideRecoil
+{
+	static FORCEINLINE void AfterShot(AWeapon* Weapon) {}
+};
+
+struct FPistolSlideRecoil
+{
+	static FORCEINLINE void AfterShot(AWeapon* Weapon) { Weapon->StartSlideTimer(); }
+};
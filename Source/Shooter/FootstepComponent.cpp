@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FootstepComponent.h"
+#include "FootstepSurfaceDataAsset.h"
+#include "AudioEventSubsystem.h"
+#include "FXPoolSubsystem.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Footsteps"), STAT_Footsteps, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Footstep surface lookups"), STAT_FootstepSurfaceLookups, STATGROUP_Shooter);
+
+UFootstepComponent::UFootstepComponent() :
+	Surfaces(nullptr),
+	CharacterMovement(nullptr),
+	FloorSurface(SurfaceType_Default),
+	bFloorSurfaceVaries(false),
+	FloorLocation(FVector::ZeroVector)
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UFootstepComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (Character)
+	{
+		CharacterMovement = Character->GetCharacterMovement();
+	}
+}
+
+bool UFootstepComponent::UpdateFloor()
+{
+	if (CharacterMovement == nullptr || !CharacterMovement->CurrentFloor.IsWalkableFloor())
+	{
+		return false;
+	}
+
+	const FHitResult& FloorHit = CharacterMovement->CurrentFloor.HitResult;
+	FloorLocation = FloorHit.ImpactPoint;
+
+	UPrimitiveComponent* NewFloorComponent = FloorHit.Component.Get();
+	if (NewFloorComponent != FloorComponent.Get())
+	{
+		FloorComponent = NewFloorComponent;
+		FloorSurface = SurfaceType_Default;
+
+		// landscape layers and per section materials aren't in the body's own material
+		bFloorSurfaceVaries = NewFloorComponent && NewFloorComponent->GetNumMaterials() != 1;
+
+		// the floor sweep doesn't return a physical material, the component's own one is used instead
+		if (NewFloorComponent && !bFloorSurfaceVaries)
+		{
+			INC_DWORD_STAT(STAT_FootstepSurfaceLookups);
+
+			const FBodyInstance* BodyInstance = NewFloorComponent->GetBodyInstance();
+			UPhysicalMaterial* PhysicalMaterial = BodyInstance ? BodyInstance->GetSimplePhysicalMaterial() : nullptr;
+			FloorSurface = UPhysicalMaterial::DetermineSurfaceType(PhysicalMaterial);
+		}
+	}
+
+	if (bFloorSurfaceVaries)
+	{
+		FloorSurface = TraceFloorSurface(NewFloorComponent, FloorHit);
+	}
+
+	return true;
+}
+
+EPhysicalSurface UFootstepComponent::TraceFloorSurface(UPrimitiveComponent* Component, const FHitResult& FloorHit) const
+{
+	INC_DWORD_STAT(STAT_FootstepSurfaceLookups);
+
+	// only the floor component is traced, not the scene
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(FootstepSurface), true, GetOwner());
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	const FVector Start = FloorHit.ImpactPoint + FloorHit.ImpactNormal * 10.f;
+	const FVector End = FloorHit.ImpactPoint - FloorHit.ImpactNormal * 10.f;
+
+	FHitResult SurfaceHit;
+	if (Component->LineTraceComponent(SurfaceHit, Start, End, QueryParams))
+	{
+		return UPhysicalMaterial::DetermineSurfaceType(SurfaceHit.PhysMaterial.Get());
+	}
+	return SurfaceType_Default;
+}
+
+EPhysicalSurface UFootstepComponent::GetSurfaceType()
+{
+	UpdateFloor();
+	return FloorSurface;
+}
+
+void UFootstepComponent::PlayFootstep()
+{
+	if (Surfaces == nullptr || !UpdateFloor())
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_Footsteps);
+
+	const FFootstepSurfaceEffect& Effect = Surfaces->GetEffect(FloorSurface);
+
+	if (Effect.Sound)
+	{
+		UAudioEventSubsystem::PlaySoundAtLocation(this, EAudioEventCategory::EAEC_Footstep, Effect.Sound, FloorLocation);
+	}
+
+	if (Effect.Particles)
+	{
+		UFXPoolSubsystem::SpawnFXAtLocation(this, Effect.Particles, FTransform(FloorLocation));
+	}
+}
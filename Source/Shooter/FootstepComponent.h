@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "FootstepComponent.generated.h"
+
+/**
+ * Footsteps of a character. The surface comes from the floor the character movement already found,
+ * it is only looked up again when the character steps onto another component - no traces per step.
+ * Landscapes and meshes with several materials are the exception, their surface changes under the
+ * feet, so every step traces just the floor component for the physical material.
+ */
+UCLASS(ClassGroup = (Audio), meta = (BlueprintSpawnableComponent))
+class SHOOTER_API UFootstepComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFootstepComponent();
+
+	// called by footstep anim notifies, nothing plays while falling
+	UFUNCTION(BlueprintCallable, Category = Footsteps)
+	void PlayFootstep();
+
+	UFUNCTION(BlueprintCallable, Category = Footsteps)
+	EPhysicalSurface GetSurfaceType();
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	// false when the character is not standing on anything
+	bool UpdateFloor();
+
+	EPhysicalSurface TraceFloorSurface(UPrimitiveComponent* Component, const FHitResult& FloorHit) const;
+
+	UPROPERTY(EditAnywhere, Category = Footsteps, meta = (AllowPrivateAccess = "true"))
+	class UFootstepSurfaceDataAsset* Surfaces;
+
+	UPROPERTY()
+	class UCharacterMovementComponent* CharacterMovement;
+
+	// surface of the last floor component
+	TWeakObjectPtr<UPrimitiveComponent> FloorComponent;
+	EPhysicalSurface FloorSurface;
+	bool bFloorSurfaceVaries;
+	FVector FloorLocation;
+};
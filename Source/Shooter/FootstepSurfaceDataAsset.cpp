@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FootstepSurfaceDataAsset.h"
+
+const FFootstepSurfaceEffect& UFootstepSurfaceDataAsset::GetEffect(EPhysicalSurface SurfaceType) const
+{
+	const FFootstepSurfaceEffect& Effect = Surfaces[SurfaceType];
+	if (Effect.Sound == nullptr && Effect.Particles == nullptr)
+	{
+		return Surfaces[SurfaceType_Default];
+	}
+
+	return Effect;
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "FootstepSurfaceDataAsset.generated.h"
+
+USTRUCT(BlueprintType)
+struct FFootstepSurfaceEffect
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	class USoundBase* Sound = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	class UParticleSystem* Particles = nullptr;
+};
+
+/**
+ * Footstep sound and particles indexed by physical surface type
+ */
+UCLASS(BlueprintType)
+class SHOOTER_API UFootstepSurfaceDataAsset : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// surfaces without sound or particles use the SurfaceType_Default entry
+	const FFootstepSurfaceEffect& GetEffect(EPhysicalSurface SurfaceType) const;
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Footsteps", meta = (AllowPrivateAccess = "true", ArraySizeEnum = "EPhysicalSurface"))
+	FFootstepSurfaceEffect Surfaces[SurfaceType_Max];
+};
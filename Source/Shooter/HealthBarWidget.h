@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "HealthBarWidget.generated.h"
+
+/**
+ * Health bar that follows an actor, placed by the world UI subsystem
+ */
+UCLASS()
+class SHOOTER_API UHealthBarWidget : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	// 0 to 1, called whenever the owner takes damage
+	UFUNCTION(BlueprintImplementableEvent)
+	void SetHealthPercent(float Percent);
+};
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "HitNumberWidget.generated.h"
+
+/**
+ * Damage number placed in the world by the world UI subsystem, reused between hits
+ */
+UCLASS()
+class SHOOTER_API UHitNumberWidget : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	// called every time the widget is taken from the pool, restart animations here
+	UFUNCTION(BlueprintImplementableEvent)
+	void ShowHitNumber(int32 Damage, bool bHeadShot);
+};
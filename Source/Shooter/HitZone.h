@@ -0,0 +1,17 @@
+#pragma once
+UENUM(BlueprintType)
+enum class EHitZone : uint8
+{
+	EHZ_Head UMETA(DisplayName = "Head"),
+	EHZ_Torso UMETA(DisplayName = "Torso"),
+	EHZ_Limb UMETA(DisplayName = "Limb"),
+
+	EHZ_MAX UMETA(DisplayName = "DefaultMAX"),
+};
+
+// hit zone of one bone after resolving the enemy's hit zone asset against its skeleton
+struct FResolvedHitZone
+{
+	EHitZone Zone;
+	float DamageMultiplier;
+};
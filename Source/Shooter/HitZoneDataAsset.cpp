@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitZoneDataAsset.h"
+
+void UHitZoneDataAsset::BuildBoneLookup(const USkeletalMeshComponent* Mesh, TArray<FResolvedHitZone>& OutBoneHitZones) const
+{
+	OutBoneHitZones.Reset();
+
+	if (Mesh == nullptr || Mesh->SkeletalMesh == nullptr)
+	{
+		return;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = Mesh->SkeletalMesh->RefSkeleton;
+	const int32 NumBones = RefSkeleton.GetNum();
+
+	OutBoneHitZones.Init(FResolvedHitZone{ DefaultZone, 1.f }, NumBones);
+
+	// 0 = default, 1 = own entry, 2 = own entry passed on to children
+	TArray<uint8> BoneSource;
+	BoneSource.Init(0, NumBones);
+
+	for (const FHitZoneBone& Bone : Bones)
+	{
+		const int32 BoneIndex = RefSkeleton.FindBoneIndex(Bone.BoneName);
+		if (BoneIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		OutBoneHitZones[BoneIndex] = FResolvedHitZone{ Bone.Zone, Bone.DamageMultiplier };
+		BoneSource[BoneIndex] = Bone.bApplyToChildren ? 2 : 1;
+	}
+
+	// parents always come before their children in the reference skeleton
+	for (int32 BoneIndex = 1; BoneIndex < NumBones; ++BoneIndex)
+	{
+		const int32 ParentIndex = RefSkeleton.GetParentIndex(BoneIndex);
+		if (BoneSource[BoneIndex] == 0 && ParentIndex != INDEX_NONE && BoneSource[ParentIndex] == 2)
+		{
+			OutBoneHitZones[BoneIndex] = OutBoneHitZones[ParentIndex];
+			BoneSource[BoneIndex] = 2;
+		}
+	}
+}
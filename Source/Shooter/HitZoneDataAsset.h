@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "HitZone.h"
+#include "HitZoneDataAsset.generated.h"
+
+USTRUCT(BlueprintType)
+struct FHitZoneBone
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName BoneName;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EHitZone Zone = EHitZone::EHZ_Torso;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float DamageMultiplier = 1.f;
+
+	// child bones without their own entry get the same zone
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bApplyToChildren = true;
+};
+
+/**
+ * Maps the bones of an enemy skeleton to hit zones
+ */
+UCLASS(BlueprintType)
+class SHOOTER_API UHitZoneDataAsset : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// builds a lookup indexed by bone index of the mesh
+	void BuildBoneLookup(const USkeletalMeshComponent* Mesh, TArray<FResolvedHitZone>& OutBoneHitZones) const;
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Hit Zones", meta = (AllowPrivateAccess = "true"))
+	TArray<FHitZoneBone> Bones;
+
+	// zone for bones that are not covered by any entry
+	UPROPERTY(EditAnywhere, Category = "Hit Zones", meta = (AllowPrivateAccess = "true"))
+	EHitZone DefaultZone = EHitZone::EHZ_Torso;
+};
@@ -0,0 +1,355 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitboxHistoryComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/Character.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hitbox History Record"), STAT_HitboxHistoryRecord, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Hitbox History Rewind"), STAT_HitboxHistoryRewind, STATGROUP_Shooter);
+
+static FAutoConsoleCommand HitboxHistoryTestCommand(
+	TEXT("shooter.HitboxHistoryTest"),
+	TEXT("Replays recorded movement through a hitbox history and checks the rewound hits."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		UHitboxHistoryComponent::RunSelfTest();
+	}));
+
+// centre offsets are stored in mm
+static constexpr float HitboxPositionScale = 10.f;
+static constexpr float HitboxAxisScale = 32767.f;
+
+static int16 QuantizeHitboxValue(float Value, float Scale)
+{
+	return static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Value * Scale), -32767, 32767));
+}
+
+void FHitboxHistory::Init(int32 InNumShapes, int32 InFrameCapacity, float InRecordInterval)
+{
+	NumShapes = InNumShapes;
+	FrameCapacity = FMath::Max(InFrameCapacity, 0);
+	RecordInterval = FMath::Max(InRecordInterval, KINDA_SMALL_NUMBER);
+	NewestFrame = INDEX_NONE;
+
+	// everything is allocated once here, recording never allocates
+	Frames.Empty(FrameCapacity);
+	Frames.SetNumZeroed(FrameCapacity);
+	Samples.Empty(FrameCapacity * NumShapes);
+	Samples.SetNumZeroed(FrameCapacity * NumShapes);
+}
+
+int32 FHitboxHistory::GetBytesPerFrame(int32 NumShapes)
+{
+	return sizeof(FHitboxFrame) + NumShapes * sizeof(FQuantizedHitbox);
+}
+
+void FHitboxHistory::Record(float Timestamp, const FVector& Origin, TArrayView<const FHitboxPose> Poses)
+{
+	if (FrameCapacity == 0 || Poses.Num() != NumShapes)
+	{
+		return;
+	}
+
+	const int64 FrameNumber = static_cast<int64>(FMath::FloorToDouble(Timestamp / RecordInterval));
+	if (FrameNumber <= NewestFrame)
+	{
+		// already have a pose for this interval
+		return;
+	}
+
+	// a long tick leaves intervals without a sample, they get this pose too - never more than one full buffer
+	const int64 FirstFrame = NewestFrame == INDEX_NONE ? FrameNumber : FMath::Max(NewestFrame + 1, FrameNumber - FrameCapacity + 1);
+	for (int64 Frame = FirstFrame; Frame <= FrameNumber; ++Frame)
+	{
+		const int32 Slot = static_cast<int32>(Frame % FrameCapacity);
+		Frames[Slot] = FHitboxFrame{ Origin, Timestamp, Frame };
+
+		FQuantizedHitbox* SlotSamples = &Samples[Slot * NumShapes];
+		for (int32 ShapeIndex = 0; ShapeIndex < NumShapes; ++ShapeIndex)
+		{
+			const FVector Offset = Poses[ShapeIndex].Center - Origin;
+			const FVector& Axis = Poses[ShapeIndex].Axis;
+
+			FQuantizedHitbox& Sample = SlotSamples[ShapeIndex];
+			Sample.Center[0] = QuantizeHitboxValue(Offset.X, HitboxPositionScale);
+			Sample.Center[1] = QuantizeHitboxValue(Offset.Y, HitboxPositionScale);
+			Sample.Center[2] = QuantizeHitboxValue(Offset.Z, HitboxPositionScale);
+			Sample.Axis[0] = QuantizeHitboxValue(Axis.X, HitboxAxisScale);
+			Sample.Axis[1] = QuantizeHitboxValue(Axis.Y, HitboxAxisScale);
+			Sample.Axis[2] = QuantizeHitboxValue(Axis.Z, HitboxAxisScale);
+		}
+	}
+
+	NewestFrame = FrameNumber;
+}
+
+void FHitboxHistory::ReadFrame(int64 FrameNumber, FHitboxPoseArray& OutPoses) const
+{
+	const int32 Slot = static_cast<int32>(FrameNumber % FrameCapacity);
+	const FVector& Origin = Frames[Slot].Origin;
+	const FQuantizedHitbox* SlotSamples = &Samples[Slot * NumShapes];
+
+	OutPoses.Reset();
+	for (int32 ShapeIndex = 0; ShapeIndex < NumShapes; ++ShapeIndex)
+	{
+		const FQuantizedHitbox& Sample = SlotSamples[ShapeIndex];
+		FHitboxPose& Pose = OutPoses.AddDefaulted_GetRef();
+		Pose.Center = Origin + FVector(Sample.Center[0], Sample.Center[1], Sample.Center[2]) / HitboxPositionScale;
+		Pose.Axis = FVector(Sample.Axis[0], Sample.Axis[1], Sample.Axis[2]) / HitboxAxisScale;
+	}
+}
+
+bool FHitboxHistory::GetPoses(float Timestamp, FHitboxPoseArray& OutPoses) const
+{
+	if (NewestFrame == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const int64 OldestFrame = GetOldestFrame();
+	int64 Frame = FMath::Min(static_cast<int64>(FMath::FloorToDouble(Timestamp / RecordInterval)), NewestFrame);
+	if (Frame < OldestFrame)
+	{
+		return false;
+	}
+
+	// the frame's pose was sampled somewhere inside its interval, step back to the sample before Timestamp
+	// only loops more than once for intervals that were filled in after a long tick
+	while (Frame > OldestFrame && Timestamp < GetFrame(Frame).Timestamp)
+	{
+		--Frame;
+	}
+
+	ReadFrame(Frame, OutPoses);
+
+	const int64 NextFrame = FMath::Min(Frame + 1, NewestFrame);
+	const float FrameTime = GetFrame(Frame).Timestamp;
+	const float NextFrameTime = GetFrame(NextFrame).Timestamp;
+	if (NextFrameTime <= FrameTime)
+	{
+		return true;
+	}
+
+	const float Alpha = FMath::Clamp((Timestamp - FrameTime) / (NextFrameTime - FrameTime), 0.f, 1.f);
+	if (Alpha > 0.f)
+	{
+		FHitboxPoseArray NextPoses;
+		ReadFrame(NextFrame, NextPoses);
+		for (int32 ShapeIndex = 0; ShapeIndex < NumShapes; ++ShapeIndex)
+		{
+			OutPoses[ShapeIndex].Center = FMath::Lerp(OutPoses[ShapeIndex].Center, NextPoses[ShapeIndex].Center, Alpha);
+			OutPoses[ShapeIndex].Axis = FMath::Lerp(OutPoses[ShapeIndex].Axis, NextPoses[ShapeIndex].Axis, Alpha).GetSafeNormal();
+		}
+	}
+
+	return true;
+}
+
+bool FHitboxHistory::SegmentHitsCapsule(const FVector& Start, const FVector& End, const FHitboxPose& Pose, float HalfHeight, float Radius, FVector& OutLocation)
+{
+	const FVector CapsuleStart = Pose.Center - Pose.Axis * HalfHeight;
+	const FVector CapsuleEnd = Pose.Center + Pose.Axis * HalfHeight;
+
+	FVector OnSegment;
+	FVector OnCapsule;
+	FMath::SegmentDistToSegmentSafe(Start, End, CapsuleStart, CapsuleEnd, OnSegment, OnCapsule);
+	if (FVector::DistSquared(OnSegment, OnCapsule) > FMath::Square(Radius))
+	{
+		return false;
+	}
+
+	OutLocation = OnSegment;
+	return true;
+}
+
+UHitboxHistoryComponent::UHitboxHistoryComponent() :
+	RecordInterval(1.f / 60.f),
+	HistoryTime(0.5f),
+	MemoryBudgetBytes(4096)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// after animation so bones are where they were drawn
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+void UHitboxHistoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ACharacter* OwnerCharacter = Cast<ACharacter>(GetOwner());
+	USkeletalMeshComponent* Mesh = OwnerCharacter ? OwnerCharacter->GetMesh() : nullptr;
+
+	if (Shapes.Num() == 0 && OwnerCharacter)
+	{
+		// no hitboxes set up - use the collision capsule
+		const UCapsuleComponent* Capsule = OwnerCharacter->GetCapsuleComponent();
+		FHitboxShape& CapsuleShape = Shapes.AddDefaulted_GetRef();
+		CapsuleShape.Axis = EAxis::Z;
+		CapsuleShape.Radius = Capsule->GetScaledCapsuleRadius();
+		CapsuleShape.HalfHeight = Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+	}
+
+	ShapeBoneIndices.Reset(Shapes.Num());
+	for (const FHitboxShape& Shape : Shapes)
+	{
+		ShapeBoneIndices.Add(Mesh && !Shape.BoneName.IsNone() ? Mesh->GetBoneIndex(Shape.BoneName) : INDEX_NONE);
+	}
+
+	// rewinding interpolates between two frames, a budget too small for them still gets two or every hit would be rejected
+	const int32 WantedFrames = FMath::CeilToInt(HistoryTime / RecordInterval) + 1;
+	const int32 BudgetFrames = FMath::Max(MemoryBudgetBytes / FHitboxHistory::GetBytesPerFrame(Shapes.Num()), 2);
+	if (BudgetFrames < WantedFrames)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: hitbox history cut to %d frames to fit %d bytes"), *GetOwner()->GetName(), BudgetFrames, MemoryBudgetBytes);
+	}
+
+	History.Init(Shapes.Num(), FMath::Min(WantedFrames, BudgetFrames), RecordInterval);
+}
+
+void UHitboxHistoryComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// only the server validates hits
+	if (!GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HitboxHistoryRecord);
+
+	FHitboxPoseArray Poses;
+	SamplePoses(Poses);
+	History.Record(GetWorld()->GetTimeSeconds(), GetOwner()->GetActorLocation(), Poses);
+}
+
+void UHitboxHistoryComponent::SamplePoses(FHitboxPoseArray& OutPoses) const
+{
+	const ACharacter* OwnerCharacter = Cast<ACharacter>(GetOwner());
+	const USkeletalMeshComponent* Mesh = OwnerCharacter ? OwnerCharacter->GetMesh() : nullptr;
+	const FTransform RootTransform = GetOwner()->GetActorTransform();
+
+	for (int32 ShapeIndex = 0; ShapeIndex < Shapes.Num(); ++ShapeIndex)
+	{
+		const int32 BoneIndex = ShapeBoneIndices[ShapeIndex];
+		const FTransform ShapeTransform = Mesh && BoneIndex != INDEX_NONE ? Mesh->GetBoneTransform(BoneIndex) : RootTransform;
+		OutPoses.Add(FHitboxPose{ ShapeTransform.GetLocation(), ShapeTransform.GetUnitAxis(Shapes[ShapeIndex].Axis) });
+	}
+}
+
+bool UHitboxHistoryComponent::RewindTrace(float Timestamp, const FVector& Start, const FVector& End, FHitboxRewindHit& OutHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_HitboxHistoryRewind);
+
+	FHitboxPoseArray Poses;
+	if (!History.GetPoses(Timestamp, Poses))
+	{
+		return false;
+	}
+
+	// closest hit to the start of the trace
+	bool bHit = false;
+	float ClosestDistSquared = TNumericLimits<float>::Max();
+	for (int32 ShapeIndex = 0; ShapeIndex < Shapes.Num(); ++ShapeIndex)
+	{
+		const FHitboxShape& Shape = Shapes[ShapeIndex];
+		FVector HitLocation;
+		if (FHitboxHistory::SegmentHitsCapsule(Start, End, Poses[ShapeIndex], Shape.HalfHeight, Shape.Radius, HitLocation))
+		{
+			const float DistSquared = FVector::DistSquared(Start, HitLocation);
+			if (DistSquared < ClosestDistSquared)
+			{
+				ClosestDistSquared = DistSquared;
+				OutHit.Location = HitLocation;
+				OutHit.Zone = Shape.Zone;
+				bHit = true;
+			}
+		}
+	}
+
+	return bHit;
+}
+
+bool UHitboxHistoryComponent::RunSelfTest()
+{
+	// one upright capsule moving along X at 600 cm/s, ticked at uneven rates so some intervals get skipped
+	const float Interval = 1.f / 60.f;
+	const int32 FrameCapacity = 30;
+	const float Radius = 30.f;
+	const float HalfHeight = 60.f;
+	const FVector Velocity(600.f, 0.f, 0.f);
+	const float TickLengths[] = { 1.f / 90.f, 1.f / 70.f, 1.f / 45.f };
+
+	auto GetCenter = [&Velocity](float Time) { return Velocity * Time + FVector(0.f, 0.f, 90.f); };
+
+	FHitboxHistory TestHistory;
+	TestHistory.Init(1, FrameCapacity, Interval);
+
+	int32 Failures = 0;
+	if (TestHistory.GetAllocatedBytes() > FrameCapacity * FHitboxHistory::GetBytesPerFrame(1))
+	{
+		UE_LOG(LogTemp, Error, TEXT("HitboxHistoryTest: %d bytes allocated, budget %d"), TestHistory.GetAllocatedBytes(), FrameCapacity * FHitboxHistory::GetBytesPerFrame(1));
+		++Failures;
+	}
+
+	float Time = 0.f;
+	for (int32 Tick = 0; Tick < 240; ++Tick)
+	{
+		const FHitboxPose Pose{ GetCenter(Time), FVector::UpVector };
+		TestHistory.Record(Time, Velocity * Time, MakeArrayView(&Pose, 1));
+		Time += TickLengths[Tick % UE_ARRAY_COUNT(TickLengths)];
+	}
+	const float NewestTime = Time - TickLengths[239 % UE_ARRAY_COUNT(TickLengths)];
+
+	// rewinds inside the history must land on the recorded path
+	int32 Checks = 0;
+	for (float RewindTime = NewestTime - (FrameCapacity - 3) * Interval; RewindTime <= NewestTime; RewindTime += Interval * 0.37f)
+	{
+		++Checks;
+
+		FHitboxPoseArray Poses;
+		if (!TestHistory.GetPoses(RewindTime, Poses))
+		{
+			UE_LOG(LogTemp, Error, TEXT("HitboxHistoryTest: no pose at %f"), RewindTime);
+			++Failures;
+			continue;
+		}
+
+		const FVector Expected = GetCenter(RewindTime);
+		if (!Poses[0].Center.Equals(Expected, 0.2f))
+		{
+			UE_LOG(LogTemp, Error, TEXT("HitboxHistoryTest: pose at %f is %s, expected %s"), RewindTime, *Poses[0].Center.ToString(), *Expected.ToString());
+			++Failures;
+		}
+
+		// straight through the rewound capsule must hit, a trace two radii in front must miss
+		FVector HitLocation;
+		const FVector Across(0.f, 500.f, 0.f);
+		if (!FHitboxHistory::SegmentHitsCapsule(Expected - Across, Expected + Across, Poses[0], HalfHeight, Radius, HitLocation))
+		{
+			UE_LOG(LogTemp, Error, TEXT("HitboxHistoryTest: trace through %s missed at %f"), *Expected.ToString(), RewindTime);
+			++Failures;
+		}
+
+		const FVector Ahead = Expected + FVector(2.f * Radius, 0.f, 0.f);
+		if (FHitboxHistory::SegmentHitsCapsule(Ahead - Across, Ahead + Across, Poses[0], HalfHeight, Radius, HitLocation))
+		{
+			UE_LOG(LogTemp, Error, TEXT("HitboxHistoryTest: trace through %s hit at %f"), *Ahead.ToString(), RewindTime);
+			++Failures;
+		}
+	}
+
+	// older than the buffer is rejected, not clamped
+	FHitboxPoseArray TooOldPoses;
+	if (TestHistory.GetPoses(NewestTime - (FrameCapacity + 5) * Interval, TooOldPoses))
+	{
+		UE_LOG(LogTemp, Error, TEXT("HitboxHistoryTest: got a pose older than the history"));
+		++Failures;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("HitboxHistoryTest: %d rewinds checked, %d failures"), Checks, Failures);
+	return Failures == 0;
+}
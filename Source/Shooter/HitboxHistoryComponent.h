@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "HitZone.h"
+#include "HitboxHistoryComponent.generated.h"
+
+USTRUCT(BlueprintType)
+struct FHitboxShape
+{
+	GENERATED_BODY()
+
+	// capsule follows this bone, None uses the actor root
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName BoneName;
+
+	// bone axis the capsule lies along
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TEnumAsByte<EAxis::Type> Axis = EAxis::X;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Radius = 15.f;
+
+	// half length of the segment between the two hemisphere centres
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float HalfHeight = 15.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EHitZone Zone = EHitZone::EHZ_Torso;
+};
+
+// capsule pose in world space
+struct FHitboxPose
+{
+	FVector Center;
+	FVector Axis;
+};
+
+using FHitboxPoseArray = TArray<FHitboxPose, TInlineAllocator<16>>;
+
+/**
+ * Fixed size ring buffer of quantised hitbox poses, one frame per record interval.
+ * Frame for a timestamp is found by dividing by the interval, no search.
+ * Frames keep the time their pose was sampled so rewinds interpolate between real samples.
+ */
+class SHOOTER_API FHitboxHistory
+{
+public:
+	void Init(int32 InNumShapes, int32 InFrameCapacity, float InRecordInterval);
+
+	// writes Poses into every record interval that started since the last call
+	void Record(float Timestamp, const FVector& Origin, TArrayView<const FHitboxPose> Poses);
+
+	// poses interpolated at Timestamp, false if the history doesn't reach back that far
+	bool GetPoses(float Timestamp, FHitboxPoseArray& OutPoses) const;
+
+	static int32 GetBytesPerFrame(int32 NumShapes);
+
+	// closest approach of a segment to a capsule, true if it is inside the radius
+	static bool SegmentHitsCapsule(const FVector& Start, const FVector& End, const FHitboxPose& Pose, float HalfHeight, float Radius, FVector& OutLocation);
+
+	// forgets every recorded frame, the buffers are kept
+	FORCEINLINE void Clear() { NewestFrame = INDEX_NONE; }
+
+	FORCEINLINE int32 GetFrameCapacity() const { return FrameCapacity; }
+	FORCEINLINE int32 GetAllocatedBytes() const { return Frames.GetAllocatedSize() + Samples.GetAllocatedSize(); }
+
+private:
+	// 12 bytes - centre offset from the frame origin in mm, axis scaled to int16
+	struct FQuantizedHitbox
+	{
+		int16 Center[3];
+		int16 Axis[3];
+	};
+
+	struct FHitboxFrame
+	{
+		FVector Origin;
+		float Timestamp;
+		int64 FrameNumber;
+	};
+
+	FORCEINLINE const FHitboxFrame& GetFrame(int64 FrameNumber) const { return Frames[FrameNumber % FrameCapacity]; }
+	FORCEINLINE int64 GetOldestFrame() const { return FMath::Max<int64>(NewestFrame - FrameCapacity + 1, 0); }
+
+	void ReadFrame(int64 FrameNumber, FHitboxPoseArray& OutPoses) const;
+
+	TArray<FHitboxFrame> Frames;
+	TArray<FQuantizedHitbox> Samples;
+
+	int32 NumShapes = 0;
+	int32 FrameCapacity = 0;
+	float RecordInterval = 1.f / 60.f;
+	int64 NewestFrame = INDEX_NONE;
+};
+
+USTRUCT(BlueprintType)
+struct FHitboxRewindHit
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly)
+	EHitZone Zone = EHitZone::EHZ_Torso;
+};
+
+/**
+ * Records the owner's hitboxes on the server so shots can be checked against where the target was when they were fired
+ */
+UCLASS(ClassGroup = (Combat), meta = (BlueprintSpawnableComponent))
+class SHOOTER_API UHitboxHistoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UHitboxHistoryComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// traces Start -> End against the hitboxes as they were at Timestamp
+	bool RewindTrace(float Timestamp, const FVector& Start, const FVector& End, FHitboxRewindHit& OutHit) const;
+
+	// replaces the configured shapes, before BeginPlay
+	FORCEINLINE void SetShapes(const TArray<FHitboxShape>& InShapes) { Shapes = InShapes; }
+
+	// after a teleport, so shots can't be rewound to where the owner was before
+	FORCEINLINE void ClearHistory() { History.Clear(); }
+
+	// replays recorded movement through a standalone history and checks rewound hits, logs the result
+	static bool RunSelfTest();
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	void SamplePoses(FHitboxPoseArray& OutPoses) const;
+
+	// empty uses the owner's collision capsule as the only hitbox, enemies with weapon hitboxes replace these with them
+	UPROPERTY(EditAnywhere, Category = "Hitbox History", meta = (AllowPrivateAccess = "true"))
+	TArray<FHitboxShape> Shapes;
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox History", meta = (AllowPrivateAccess = "true"))
+	float RecordInterval;
+
+	// how far back shots can be rewound
+	UPROPERTY(EditAnywhere, Category = "Hitbox History", meta = (AllowPrivateAccess = "true"))
+	float HistoryTime;
+
+	// hard cap, HistoryTime is shortened if the frames don't fit
+	UPROPERTY(EditAnywhere, Category = "Hitbox History", meta = (AllowPrivateAccess = "true"))
+	int32 MemoryBudgetBytes;
+
+	// bone index per shape, INDEX_NONE for the root
+	TArray<int32> ShapeBoneIndices;
+
+	FHitboxHistory History;
+};
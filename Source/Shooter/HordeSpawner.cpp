@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HordeSpawner.h"
+#include "Enemy.h"
+#include "HordeSubsystem.h"
+
+// Sets default values
+AHordeSpawner::AHordeSpawner() :
+	AgentCount(1000),
+	SpawnRadius(5000.f),
+	ImpostorMesh(nullptr),
+	ImpostorMaterial(nullptr)
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>(TEXT("Root")));
+}
+
+// Called when the game starts or when spawned
+void AHordeSpawner::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// the agents only live on the server, clients just see the promoted enemies
+	UHordeSubsystem* Horde = GetWorld()->GetSubsystem<UHordeSubsystem>();
+	if (Horde && HasAuthority())
+	{
+		Horde->SetImpostorMesh(ImpostorMesh, ImpostorMaterial);
+		Horde->AddAgents(EnemyClass, GetActorLocation(), SpawnRadius, AgentCount);
+	}
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "HordeSpawner.generated.h"
+
+/**
+ * Adds a horde of simulated enemies around itself when play starts, see UHordeSubsystem
+ */
+UCLASS()
+class SHOOTER_API AHordeSpawner : public AActor
+{
+	GENERATED_BODY()
+	
+public:	
+	// Sets default values for this actor's properties
+	AHordeSpawner();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+private:
+	// the agents become enemies of this class near a player
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Horde, meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<class AEnemy> EnemyClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Horde, meta = (AllowPrivateAccess = "true", ClampMin = "0"))
+	int32 AgentCount;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Horde, meta = (AllowPrivateAccess = "true", ClampMin = "0"))
+	float SpawnRadius;
+
+	// drawn for agents that aren't enemies yet, nothing is drawn for them when empty
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Horde, meta = (AllowPrivateAccess = "true"))
+	class UStaticMesh* ImpostorMesh;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Horde, meta = (AllowPrivateAccess = "true"))
+	class UMaterialInterface* ImpostorMaterial;
+};
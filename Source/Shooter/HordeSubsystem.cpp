@@ -0,0 +1,589 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HordeSubsystem.h"
+#include "Enemy.h"
+#include "EnemyPoolSubsystem.h"
+#include "ShooterCharacter.h"
+#include "Async/ParallelFor.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Materials/MaterialInterface.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Horde update"), STAT_HordeUpdate, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Horde step"), STAT_HordeStep, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Horde agents"), STAT_HordeAgents, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Horde agents promoted"), STAT_HordeAgentsPromoted, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<float> CVarHordePromoteDistance(
+	TEXT("shooter.HordePromoteDistance"),
+	2500.f,
+	TEXT("Horde agents closer than this to a player become full enemies."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarHordeDemoteDistance(
+	TEXT("shooter.HordeDemoteDistance"),
+	3500.f,
+	TEXT("Promoted horde enemies further than this from every player go back to the simulation, larger than the promote distance."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarHordeMaxPromoted(
+	TEXT("shooter.HordeMaxPromoted"),
+	64,
+	TEXT("Most horde agents that are full enemies at once."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarHordeParallel(
+	TEXT("shooter.HordeParallel"),
+	1,
+	TEXT("0: step the horde on the game thread only, 1: spread the agents over the task threads."),
+	ECVF_Default);
+
+static FAutoConsoleCommand HordeBenchmarkCommand(
+	TEXT("shooter.HordeBenchmark"),
+	TEXT("Steps a horde around 4 players without a world, single threaded and in parallel, and logs the cost per step.\n")
+	TEXT("shooter.HordeBenchmark [AgentCount=10000] [StepCount=300]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 AgentCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+		const int32 StepCount = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 300;
+		UHordeSubsystem::RunBenchmark(AgentCount, StepCount);
+	}));
+
+// agents stepped by one task
+static const int32 HordeChunkSize = 512;
+
+// how far above and below the agent a promoted enemy looks for the floor
+static const float PromoteFloorTraceHeight = 1000.f;
+
+int32 FHordeSimulation::Add(const FVector& Location, float Health)
+{
+	Velocities.Add(FVector::ZeroVector);
+	Healths.Add(Health);
+	States.Add(EHordeAgentState::Idle);
+	AttackCooldowns.Add(0.f);
+	PlayerDistances.Add(BIG_NUMBER);
+	return Positions.Add(Location);
+}
+
+void FHordeSimulation::RemoveAtSwap(int32 Index)
+{
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	Healths.RemoveAtSwap(Index, 1, false);
+	States.RemoveAtSwap(Index, 1, false);
+	AttackCooldowns.RemoveAtSwap(Index, 1, false);
+	PlayerDistances.RemoveAtSwap(Index, 1, false);
+}
+
+void FHordeSimulation::BuildGrid()
+{
+	const int32 NumAgents = Num();
+
+	// about two buckets per agent keeps the chains short
+	const int32 NumBuckets = FMath::RoundUpToPowerOfTwo(FMath::Max(NumAgents * 2, 64));
+	BucketHeads.Init(INDEX_NONE, NumBuckets);
+	NextInBucket.SetNumUninitialized(NumAgents, false);
+	Cells.SetNumUninitialized(NumAgents, false);
+
+	for (int32 Index = 0; Index < NumAgents; ++Index)
+	{
+		NextInBucket[Index] = INDEX_NONE;
+
+		// promoted agents still push the others away, their actors have a capsule
+		if (States[Index] == EHordeAgentState::Dead)
+		{
+			continue;
+		}
+
+		const FIntPoint Cell = GetCell(Positions[Index]);
+		const int32 Bucket = GetBucket(Cell);
+		Cells[Index] = Cell;
+		NextInBucket[Index] = BucketHeads[Bucket];
+		BucketHeads[Bucket] = Index;
+	}
+}
+
+void FHordeSimulation::Step(float DeltaTime, bool bParallel)
+{
+	const int32 NumAgents = Num();
+
+	BuildGrid();
+
+	NewVelocities.SetNumUninitialized(NumAgents, false);
+	AttackedPlayers.SetNumUninitialized(NumAgents, false);
+
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumAgents, HordeChunkSize);
+	ParallelFor(NumChunks, [this, NumAgents, DeltaTime](int32 Chunk)
+	{
+		const int32 End = FMath::Min((Chunk + 1) * HordeChunkSize, NumAgents);
+		for (int32 Index = Chunk * HordeChunkSize; Index < End; ++Index)
+		{
+			StepAgent(Index, DeltaTime);
+		}
+	}, !bParallel);
+
+	PlayerDamage.Init(0.f, PlayerLocations.Num());
+	for (int32 Index = 0; Index < NumAgents; ++Index)
+	{
+		const EHordeAgentState State = States[Index];
+		if (State == EHordeAgentState::Dead || State == EHordeAgentState::Promoted)
+		{
+			continue;
+		}
+
+		Velocities[Index] = NewVelocities[Index];
+		Positions[Index] += NewVelocities[Index] * DeltaTime;
+
+		if (AttackedPlayers[Index] != INDEX_NONE)
+		{
+			PlayerDamage[AttackedPlayers[Index]] += AttackDamage;
+		}
+	}
+}
+
+void FHordeSimulation::StepAgent(int32 Index, float DeltaTime)
+{
+	AttackedPlayers[Index] = INDEX_NONE;
+	NewVelocities[Index] = FVector::ZeroVector;
+
+	const EHordeAgentState State = States[Index];
+	if (State == EHordeAgentState::Dead)
+	{
+		return;
+	}
+
+	const FVector& Position = Positions[Index];
+
+	int32 NearestPlayer = INDEX_NONE;
+	float NearestDistanceSquared = BIG_NUMBER;
+	for (int32 PlayerIndex = 0; PlayerIndex < PlayerLocations.Num(); ++PlayerIndex)
+	{
+		const float DistanceSquared = FVector::DistSquared2D(Position, PlayerLocations[PlayerIndex]);
+		if (DistanceSquared < NearestDistanceSquared)
+		{
+			NearestDistanceSquared = DistanceSquared;
+			NearestPlayer = PlayerIndex;
+		}
+	}
+	PlayerDistances[Index] = FMath::Sqrt(NearestDistanceSquared);
+
+	// the actor does its own steering and attacking
+	if (State == EHordeAgentState::Promoted)
+	{
+		return;
+	}
+
+	AttackCooldowns[Index] = FMath::Max(AttackCooldowns[Index] - DeltaTime, 0.f);
+
+	FVector DesiredVelocity = FVector::ZeroVector;
+	if (NearestPlayer == INDEX_NONE || NearestDistanceSquared > FMath::Square(ChaseRadius))
+	{
+		States[Index] = EHordeAgentState::Idle;
+	}
+	else if (NearestDistanceSquared <= FMath::Square(AttackRange))
+	{
+		States[Index] = EHordeAgentState::Attacking;
+		if (AttackCooldowns[Index] <= 0.f)
+		{
+			AttackCooldowns[Index] = AttackInterval;
+			AttackedPlayers[Index] = NearestPlayer;
+		}
+	}
+	else
+	{
+		States[Index] = EHordeAgentState::Chasing;
+		const FVector ToPlayer = PlayerLocations[NearestPlayer] - Position;
+		DesiredVelocity = FVector(ToPlayer.X, ToPlayer.Y, 0.f) * (MaxSpeed / PlayerDistances[Index]);
+	}
+
+	// separation, cells are two radii wide so the neighbours are in the 3x3 block around us
+	FVector Separation = FVector::ZeroVector;
+	const FIntPoint& AgentCell = Cells[Index];
+	for (int32 X = AgentCell.X - 1; X <= AgentCell.X + 1; ++X)
+	{
+		for (int32 Y = AgentCell.Y - 1; Y <= AgentCell.Y + 1; ++Y)
+		{
+			const FIntPoint Cell(X, Y);
+			for (int32 Other = BucketHeads[GetBucket(Cell)]; Other != INDEX_NONE; Other = NextInBucket[Other])
+			{
+				// other cells can share the bucket
+				if (Other == Index || Cells[Other] != Cell)
+				{
+					continue;
+				}
+
+				const FVector Away(Position.X - Positions[Other].X, Position.Y - Positions[Other].Y, 0.f);
+				const float DistanceSquared = Away.SizeSquared();
+				if (DistanceSquared >= FMath::Square(SeparationRadius))
+				{
+					continue;
+				}
+
+				// stacked agents split along their index so they don't stay stuck together
+				const float Distance = FMath::Sqrt(DistanceSquared);
+				const FVector Direction = Distance > KINDA_SMALL_NUMBER ? Away / Distance : FVector(Index < Other ? 1.f : -1.f, 0.f, 0.f);
+				Separation += Direction * (1.f - Distance / SeparationRadius);
+			}
+		}
+	}
+
+	DesiredVelocity = (DesiredVelocity + Separation * MaxSpeed * SeparationStrength).GetClampedToMaxSize(MaxSpeed);
+	NewVelocities[Index] = FMath::Lerp(Velocities[Index], DesiredVelocity, FMath::Min(DeltaTime * 8.f, 1.f));
+}
+
+void UHordeSubsystem::Deinitialize()
+{
+	if (ImpostorComponent)
+	{
+		ImpostorComponent->DestroyComponent();
+		ImpostorComponent = nullptr;
+	}
+
+	// the promoted actors go with the world
+	Simulation = FHordeSimulation();
+	AgentClassIndices.Reset();
+	AgentClasses.Reset();
+	PromotedAgents.Reset();
+	PromotedActors.Reset();
+	Players.Reset();
+
+	Super::Deinitialize();
+}
+
+void UHordeSubsystem::AddAgents(TSubclassOf<AEnemy> EnemyClass, const FVector& Center, float Radius, int32 Count)
+{
+	// the server owns the horde, clients only see the promoted enemies
+	if (EnemyClass == nullptr || GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	int32 ClassIndex = AgentClasses.Find(EnemyClass);
+	if (ClassIndex == INDEX_NONE)
+	{
+		check(AgentClasses.Num() < MAX_uint8);
+		ClassIndex = AgentClasses.Add(EnemyClass);
+	}
+
+	const float Health = EnemyClass->GetDefaultObject<AEnemy>()->GetMaxHealth();
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		// uniform over the disc
+		const float Angle = FMath::FRandRange(0.f, 2.f * PI);
+		const float Distance = FMath::Sqrt(FMath::FRand()) * Radius;
+		Simulation.Add(Center + FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 0.f), Health);
+		AgentClassIndices.Add(static_cast<uint8>(ClassIndex));
+	}
+}
+
+void UHordeSubsystem::SetImpostorMesh(UStaticMesh* Mesh, UMaterialInterface* Material)
+{
+	if (Mesh == nullptr || GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	if (ImpostorComponent == nullptr)
+	{
+		UWorld* World = GetWorld();
+		ImpostorComponent = NewObject<UInstancedStaticMeshComponent>(World);
+		ImpostorComponent->SetMobility(EComponentMobility::Movable);
+		ImpostorComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		ImpostorComponent->SetCastShadow(false);
+		ImpostorComponent->RegisterComponentWithWorld(World);
+	}
+
+	ImpostorComponent->SetStaticMesh(Mesh);
+	if (Material)
+	{
+		ImpostorComponent->SetMaterial(0, Material);
+	}
+}
+
+void UHordeSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HordeUpdate);
+
+	Players.Reset();
+	Simulation.PlayerLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		AShooterCharacter* Player = It->Get() ? Cast<AShooterCharacter>(It->Get()->GetPawn()) : nullptr;
+		if (Player && !Player->IsDead())
+		{
+			Players.Add(Player);
+			Simulation.PlayerLocations.Add(Player->GetActorLocation());
+		}
+	}
+
+	SyncPromoted();
+	RemoveDeadAgents();
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_HordeStep);
+		Simulation.Step(DeltaTime, CVarHordeParallel.GetValueOnGameThread() != 0);
+	}
+
+	ApplyPlayerDamage();
+	PromoteAgents();
+	UpdateImpostors();
+
+	SET_DWORD_STAT(STAT_HordeAgents, Simulation.Num());
+	SET_DWORD_STAT(STAT_HordeAgentsPromoted, PromotedAgents.Num());
+}
+
+void UHordeSubsystem::SyncPromoted()
+{
+	const float DemoteDistance = CVarHordeDemoteDistance.GetValueOnGameThread();
+
+	// going backwards, the entry swapped in from the end was already checked
+	for (int32 Index = PromotedAgents.Num() - 1; Index >= 0; --Index)
+	{
+		const int32 AgentIndex = PromotedAgents[Index];
+		AEnemy* Enemy = PromotedActors[Index];
+
+		// a killed enemy finishes dying and pools itself, its agent is done
+		if (Enemy == nullptr || Enemy->IsPendingKill() || Enemy->IsDying())
+		{
+			Simulation.States[AgentIndex] = EHordeAgentState::Dead;
+			PromotedAgents.RemoveAtSwap(Index, 1, false);
+			PromotedActors.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		Simulation.Positions[AgentIndex] = Enemy->GetActorLocation();
+		Simulation.Velocities[AgentIndex] = Enemy->GetVelocity();
+		Simulation.Healths[AgentIndex] = Enemy->GetHealth();
+
+		// distance is from the last step, one frame old is close enough with the gap to the promote distance
+		if (Simulation.PlayerDistances[AgentIndex] > DemoteDistance)
+		{
+			Demote(Index);
+		}
+	}
+}
+
+void UHordeSubsystem::RemoveDeadAgents()
+{
+	// going backwards, the agent swapped in from the end was already checked
+	for (int32 AgentIndex = Simulation.Num() - 1; AgentIndex >= 0; --AgentIndex)
+	{
+		if (Simulation.States[AgentIndex] != EHordeAgentState::Dead)
+		{
+			continue;
+		}
+
+		// a promoted agent moved from the end keeps its actor
+		const int32 LastIndex = Simulation.Num() - 1;
+		const int32 PromotedIndex = AgentIndex != LastIndex ? PromotedAgents.Find(LastIndex) : INDEX_NONE;
+		if (PromotedIndex != INDEX_NONE)
+		{
+			PromotedAgents[PromotedIndex] = AgentIndex;
+		}
+
+		Simulation.RemoveAtSwap(AgentIndex);
+		AgentClassIndices.RemoveAtSwap(AgentIndex, 1, false);
+	}
+}
+
+void UHordeSubsystem::PromoteAgents()
+{
+	const float PromoteDistance = CVarHordePromoteDistance.GetValueOnGameThread();
+	const int32 MaxPromoted = CVarHordeMaxPromoted.GetValueOnGameThread();
+
+	for (int32 AgentIndex = 0; AgentIndex < Simulation.Num() && PromotedAgents.Num() < MaxPromoted; ++AgentIndex)
+	{
+		const EHordeAgentState State = Simulation.States[AgentIndex];
+		if (State != EHordeAgentState::Dead && State != EHordeAgentState::Promoted && Simulation.PlayerDistances[AgentIndex] <= PromoteDistance)
+		{
+			Promote(AgentIndex);
+		}
+	}
+}
+
+void UHordeSubsystem::Promote(int32 AgentIndex)
+{
+	UEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UEnemyPoolSubsystem>();
+	if (EnemyPool == nullptr)
+	{
+		return;
+	}
+
+	const FVector& Velocity = Simulation.Velocities[AgentIndex];
+	const FRotator Rotation(0.f, Velocity.IsNearlyZero() ? 0.f : Velocity.Rotation().Yaw, 0.f);
+
+	// agents move at the spawner's height, the actor stands on the floor under the agent
+	const TSubclassOf<AEnemy> EnemyClass = AgentClasses[AgentClassIndices[AgentIndex]];
+	const AEnemy* DefaultEnemy = EnemyClass ? EnemyClass->GetDefaultObject<AEnemy>() : nullptr;
+	const float HalfHeight = DefaultEnemy && DefaultEnemy->GetCapsuleComponent() ? DefaultEnemy->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() : 0.f;
+
+	FVector Location = Simulation.Positions[AgentIndex];
+	const FVector TraceOffset(0.f, 0.f, PromoteFloorTraceHeight);
+	FHitResult FloorHit;
+	if (GetWorld()->LineTraceSingleByObjectType(FloorHit, Location + TraceOffset, Location - TraceOffset, FCollisionObjectQueryParams(ECC_WorldStatic), FCollisionQueryParams(SCENE_QUERY_STAT(HordePromoteFloor))))
+	{
+		Location.Z = FloorHit.ImpactPoint.Z;
+	}
+	Location.Z += HalfHeight;
+
+	AEnemy* Enemy = EnemyPool->SpawnEnemy(EnemyClass, FTransform(Rotation, Location));
+	if (Enemy == nullptr)
+	{
+		return;
+	}
+
+	Enemy->SetHealth(Simulation.Healths[AgentIndex]);
+	Simulation.States[AgentIndex] = EHordeAgentState::Promoted;
+	PromotedAgents.Add(AgentIndex);
+	PromotedActors.Add(Enemy);
+
+	// the agent was already chasing, the enemy shouldn't wait for its agro range
+	AShooterCharacter* NearestPlayer = nullptr;
+	float NearestDistanceSquared = BIG_NUMBER;
+	for (AShooterCharacter* Player : Players)
+	{
+		const float DistanceSquared = FVector::DistSquared(Player->GetActorLocation(), Simulation.Positions[AgentIndex]);
+		if (DistanceSquared < NearestDistanceSquared)
+		{
+			NearestDistanceSquared = DistanceSquared;
+			NearestPlayer = Player;
+		}
+	}
+
+	if (NearestPlayer)
+	{
+		Enemy->OnPlayerEnteredAgroRange(NearestPlayer);
+	}
+}
+
+void UHordeSubsystem::Demote(int32 PromotedIndex)
+{
+	const int32 AgentIndex = PromotedAgents[PromotedIndex];
+	AEnemy* Enemy = PromotedActors[PromotedIndex];
+
+	Simulation.States[AgentIndex] = EHordeAgentState::Idle;
+	Simulation.Velocities[AgentIndex] = FVector::ZeroVector;
+
+	UEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UEnemyPoolSubsystem>();
+	if (EnemyPool == nullptr || !EnemyPool->ReleaseEnemy(Enemy))
+	{
+		Enemy->Destroy();
+	}
+
+	PromotedAgents.RemoveAtSwap(PromotedIndex, 1, false);
+	PromotedActors.RemoveAtSwap(PromotedIndex, 1, false);
+}
+
+void UHordeSubsystem::ApplyPlayerDamage()
+{
+	// one damage event per player for all the agents that hit it this step
+	for (int32 PlayerIndex = 0; PlayerIndex < Players.Num(); ++PlayerIndex)
+	{
+		const float Damage = Simulation.PlayerDamage[PlayerIndex];
+		if (Damage > 0.f)
+		{
+			UGameplayStatics::ApplyDamage(Players[PlayerIndex], Damage, nullptr, nullptr, UDamageType::StaticClass());
+		}
+	}
+}
+
+void UHordeSubsystem::UpdateImpostors()
+{
+	if (ImpostorComponent == nullptr)
+	{
+		return;
+	}
+
+	// one instance per agent, promoted and dead agents are scaled to nothing
+	const int32 NumAgents = Simulation.Num();
+	ImpostorTransforms.Reset(NumAgents);
+	for (int32 Index = 0; Index < NumAgents; ++Index)
+	{
+		const EHordeAgentState State = Simulation.States[Index];
+		if (State == EHordeAgentState::Dead || State == EHordeAgentState::Promoted)
+		{
+			ImpostorTransforms.Add(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector));
+			continue;
+		}
+
+		const FVector& Velocity = Simulation.Velocities[Index];
+		const FQuat Rotation = Velocity.IsNearlyZero() ? FQuat::Identity : FRotator(0.f, Velocity.Rotation().Yaw, 0.f).Quaternion();
+		ImpostorTransforms.Add(FTransform(Rotation, Simulation.Positions[Index]));
+	}
+
+	// instances are never removed, the ones past the agents left are scaled to nothing
+	for (int32 Index = NumAgents; Index < ImpostorComponent->GetInstanceCount(); ++Index)
+	{
+		ImpostorTransforms.Add(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector));
+	}
+
+	// component sits at the origin, instance space is world space
+	while (ImpostorComponent->GetInstanceCount() < NumAgents)
+	{
+		ImpostorComponent->AddInstance(FTransform::Identity);
+	}
+
+	if (ImpostorTransforms.Num() > 0)
+	{
+		ImpostorComponent->BatchUpdateInstancesTransforms(0, ImpostorTransforms, true, true, false);
+	}
+}
+
+void UHordeSubsystem::RunBenchmark(int32 AgentCount, int32 StepCount)
+{
+	AgentCount = FMath::Max(AgentCount, 1);
+	StepCount = FMath::Max(StepCount, 1);
+
+	for (int32 Run = 0; Run < 2; ++Run)
+	{
+		const bool bParallel = Run == 1;
+
+		// same layout for both runs
+		FRandomStream RandomStream(AgentCount);
+		const float Radius = FMath::Sqrt(static_cast<float>(AgentCount)) * 150.f;
+
+		FHordeSimulation BenchmarkSimulation;
+		for (int32 Index = 0; Index < AgentCount; ++Index)
+		{
+			const float Angle = RandomStream.FRandRange(0.f, 2.f * PI);
+			const float Distance = FMath::Sqrt(RandomStream.FRand()) * Radius;
+			BenchmarkSimulation.Add(FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 0.f), 100.f);
+		}
+		for (int32 Index = 0; Index < 4; ++Index)
+		{
+			BenchmarkSimulation.PlayerLocations.Add(FVector(RandomStream.FRandRange(-Radius, Radius), RandomStream.FRandRange(-Radius, Radius), 0.f) * 0.5f);
+		}
+
+		// first step sizes the arrays
+		BenchmarkSimulation.Step(1.f / 30.f, bParallel);
+
+		double MaxStepMs = 0.0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Step = 0; Step < StepCount; ++Step)
+		{
+			const double StepStartTime = FPlatformTime::Seconds();
+			BenchmarkSimulation.Step(1.f / 30.f, bParallel);
+			MaxStepMs = FMath::Max(MaxStepMs, (FPlatformTime::Seconds() - StepStartTime) * 1000.0);
+		}
+		const double StepMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / StepCount;
+
+		UE_LOG(LogTemp, Log, TEXT("Horde benchmark: %d agents %s, %.3f ms per step (worst %.3f), %.1f ns per agent"),
+			AgentCount, bParallel ? TEXT("parallel") : TEXT("single threaded"), StepMs, MaxStepMs, StepMs * 1.0e6 / AgentCount);
+	}
+}
+
+ETickableTickType UHordeSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UHordeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHordeSubsystem, STATGROUP_Tickables);
+}
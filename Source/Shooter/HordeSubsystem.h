@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "HordeSubsystem.generated.h"
+
+class AEnemy;
+class AShooterCharacter;
+class UStaticMesh;
+class UMaterialInterface;
+class UInstancedStaticMeshComponent;
+
+enum class EHordeAgentState : uint8
+{
+	Idle,
+	Chasing,
+	Attacking,
+	// a full enemy actor stands in for the row, the simulation only reads its position
+	Promoted,
+	// removed from the simulation at the start of the next tick
+	Dead
+};
+
+/**
+ * Horde agents as structure of arrays. Each step hashes the agents into a uniform grid,
+ * then steers them towards the nearest player, separates them from their neighbours and
+ * runs their attacks in parallel chunks. Agents move in the XY plane at their spawn height.
+ * Plain struct so it can be stepped without a world (benchmark).
+ */
+struct FHordeSimulation
+{
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> Healths;
+	TArray<EHordeAgentState> States;
+	TArray<float> AttackCooldowns;
+
+	// distance to the nearest player after the last step
+	TArray<float> PlayerDistances;
+
+	TArray<FVector> PlayerLocations;
+
+	// damage each player took in the last step
+	TArray<float> PlayerDamage;
+
+	float MaxSpeed = 400.f;
+	float ChaseRadius = 8000.f;
+	float SeparationRadius = 120.f;
+	float SeparationStrength = 2.f;
+	float AttackRange = 150.f;
+	float AttackDamage = 10.f;
+	float AttackInterval = 1.5f;
+
+	FORCEINLINE int32 Num() const { return Positions.Num(); }
+
+	int32 Add(const FVector& Location, float Health);
+
+	// the last agent takes the removed agent's index
+	void RemoveAtSwap(int32 Index);
+
+	// bParallel spreads the agents over the task threads in chunks
+	void Step(float DeltaTime, bool bParallel);
+
+private:
+	FORCEINLINE FIntPoint GetCell(const FVector& Location) const
+	{
+		const float CellSize = SeparationRadius * 2.f;
+		return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+	}
+
+	FORCEINLINE int32 GetBucket(const FIntPoint& Cell) const
+	{
+		const uint32 Hash = (static_cast<uint32>(Cell.X) * 73856093u) ^ (static_cast<uint32>(Cell.Y) * 19349663u);
+		return static_cast<int32>(Hash & static_cast<uint32>(BucketHeads.Num() - 1));
+	}
+
+	void BuildGrid();
+
+	// one agent, writes only its own rows of the outputs
+	void StepAgent(int32 Index, float DeltaTime);
+
+	TArray<int32> BucketHeads;
+	TArray<int32> NextInBucket;
+	TArray<FIntPoint> Cells;
+
+	// filled in parallel, applied after all agents were stepped
+	TArray<FVector> NewVelocities;
+	TArray<int32> AttackedPlayers;
+};
+
+/**
+ * Horde mode. Thousands of lightweight Grux live only as rows of the simulation, one is promoted
+ * to a pooled AEnemy when it gets close to a player and demoted back to a row when it is far again.
+ * Distant agents can be drawn as instances of one impostor mesh.
+ * Runs on the server only.
+ */
+UCLASS()
+class SHOOTER_API UHordeSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// scatters Count agents on a disc, they become EnemyClass actors when promoted
+	void AddAgents(TSubclassOf<AEnemy> EnemyClass, const FVector& Center, float Radius, int32 Count);
+
+	void SetImpostorMesh(UStaticMesh* Mesh, UMaterialInterface* Material);
+
+	FORCEINLINE int32 GetAgentCount() const { return Simulation.Num(); }
+	FORCEINLINE int32 GetPromotedCount() const { return PromotedAgents.Num(); }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return Simulation.Num() > 0; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+	// steps AgentCount agents around 4 players StepCount times without a world and logs ms per step
+	static void RunBenchmark(int32 AgentCount, int32 StepCount);
+
+private:
+	void SyncPromoted();
+	// dead rows are dropped so the step and the promotion scan only walk live agents
+	void RemoveDeadAgents();
+	void PromoteAgents();
+	void Promote(int32 AgentIndex);
+	void Demote(int32 PromotedIndex);
+	void ApplyPlayerDamage();
+	void UpdateImpostors();
+
+	FHordeSimulation Simulation;
+
+	// enemy class of each agent, as an index into AgentClasses
+	TArray<uint8> AgentClassIndices;
+
+	UPROPERTY()
+	TArray<UClass*> AgentClasses;
+
+	TArray<int32> PromotedAgents;
+
+	UPROPERTY()
+	TArray<AEnemy*> PromotedActors;
+
+	// players of the current tick, same order as Simulation.PlayerLocations
+	UPROPERTY()
+	TArray<AShooterCharacter*> Players;
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* ImpostorComponent = nullptr;
+
+	// reused every frame
+	TArray<FTransform> ImpostorTransforms;
+};
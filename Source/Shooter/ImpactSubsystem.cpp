@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ImpactSubsystem.h"
+#include "ImpactSurfaceDataAsset.h"
+#include "FXPoolSubsystem.h"
+#include "Components/DecalComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Shooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts"), STAT_Impacts, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impact decal components"), STAT_ImpactDecalComponents, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarImpactDecalCount(
+	TEXT("shooter.ImpactDecalCount"),
+	64,
+	TEXT("Most bullet hole decals in the world, the oldest one is reused past this."),
+	ECVF_Default);
+
+void UImpactSubsystem::Deinitialize()
+{
+	for (UDecalComponent* Decal : DecalRing)
+	{
+		if (Decal)
+		{
+			Decal->DestroyComponent();
+		}
+	}
+
+	DecalRing.Reset();
+	NextDecal = 0;
+
+	Super::Deinitialize();
+}
+
+void UImpactSubsystem::SpawnImpact(const FHitResult& HitResult)
+{
+	if (SurfaceTable == nullptr || GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_Impacts);
+
+	const EPhysicalSurface SurfaceType = UPhysicalMaterial::DetermineSurfaceType(HitResult.PhysMaterial.Get());
+	const FImpactSurfaceEffect& Effect = SurfaceTable->GetEffect(SurfaceType);
+
+	if (Effect.Particles)
+	{
+		UFXPoolSubsystem* FXPool = GetWorld()->GetSubsystem<UFXPoolSubsystem>();
+		if (FXPool)
+		{
+			FXPool->SpawnFX(Effect.Particles, HitResult.Location, HitResult.ImpactNormal.Rotation());
+		}
+	}
+
+	if (Effect.DecalMaterial)
+	{
+		PlaceDecal(Effect.DecalMaterial, Effect.DecalSize, HitResult.ImpactPoint, HitResult.ImpactNormal);
+	}
+}
+
+void UImpactSubsystem::PlaceDecal(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FVector& Normal)
+{
+	const int32 Capacity = FMath::Max(CVarImpactDecalCount.GetValueOnGameThread(), 1);
+
+	UDecalComponent* Decal = nullptr;
+	if (DecalRing.Num() < Capacity && NextDecal == DecalRing.Num())
+	{
+		UWorld* World = GetWorld();
+		Decal = NewObject<UDecalComponent>(World);
+		Decal->SetAbsolute(true, true, true);
+		Decal->RegisterComponentWithWorld(World);
+		DecalRing.Add(Decal);
+
+		INC_DWORD_STAT(STAT_ImpactDecalComponents);
+	}
+	else
+	{
+		// ring is full, the oldest decal moves to the new hit
+		Decal = DecalRing[NextDecal % DecalRing.Num()];
+	}
+
+	NextDecal = (NextDecal + 1) % Capacity;
+
+	// decals project along their X axis, into the surface
+	FRotator Rotation = (-Normal).Rotation();
+	Rotation.Roll = FMath::FRandRange(-180.f, 180.f);
+
+	Decal->SetDecalMaterial(DecalMaterial);
+	Decal->DecalSize = DecalSize;
+	Decal->SetWorldLocationAndRotation(Location, Rotation);
+	Decal->MarkRenderStateDirty();
+}
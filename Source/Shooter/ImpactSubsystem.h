@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ImpactSubsystem.generated.h"
+
+class UDecalComponent;
+class UImpactSurfaceDataAsset;
+
+/**
+ * Bullet impacts on the world. The surface comes from the physical material of the weapon hit,
+ * particles go through the FX pool and decals into a fixed ring of components that reuses the oldest one.
+ */
+UCLASS()
+class SHOOTER_API UImpactSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	void SetSurfaceTable(UImpactSurfaceDataAsset* InSurfaceTable) { SurfaceTable = InSurfaceTable; }
+	FORCEINLINE bool HasSurfaceTable() const { return SurfaceTable != nullptr; }
+
+	// the hit has to be traced with bReturnPhysicalMaterial, otherwise the default surface is used
+	void SpawnImpact(const FHitResult& HitResult);
+
+private:
+	void PlaceDecal(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FVector& Normal);
+
+	UPROPERTY()
+	UImpactSurfaceDataAsset* SurfaceTable = nullptr;
+
+	// grows to shooter.ImpactDecalCount, then the oldest decal is moved
+	UPROPERTY()
+	TArray<UDecalComponent*> DecalRing;
+
+	int32 NextDecal = 0;
+};
@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ImpactSurfaceDataAsset.h"
+
+const FImpactSurfaceEffect& UImpactSurfaceDataAsset::GetEffect(EPhysicalSurface SurfaceType) const
+{
+	const FImpactSurfaceEffect& Effect = Surfaces[SurfaceType];
+	if (Effect.Particles == nullptr && Effect.DecalMaterial == nullptr)
+	{
+		return Surfaces[SurfaceType_Default];
+	}
+
+	return Effect;
+}
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "ImpactSurfaceDataAsset.generated.h"
+
+USTRUCT(BlueprintType)
+struct FImpactSurfaceEffect
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	class UParticleSystem* Particles = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	class UMaterialInterface* DecalMaterial = nullptr;
+
+	// X is the projection depth
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector DecalSize = FVector(8.f, 6.f, 6.f);
+};
+
+/**
+ * Bullet impact effects indexed by physical surface type
+ */
+UCLASS(BlueprintType)
+class SHOOTER_API UImpactSurfaceDataAsset : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// surfaces without particles or decal use the SurfaceType_Default entry
+	const FImpactSurfaceEffect& GetEffect(EPhysicalSurface SurfaceType) const;
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Impacts", meta = (AllowPrivateAccess = "true", ArraySizeEnum = "EPhysicalSurface"))
+	FImpactSurfaceEffect Surfaces[SurfaceType_Max];
+};
@@ -12,6 +12,7 @@
 
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
+#include "AudioEventSubsystem.h"
 
 // Sets default values
 AItem::AItem() :
@@ -347,23 +348,10 @@ FVector AItem::GetInterpLocation()
 
 void AItem::PlayPickupSound(bool bForcePlaySound)
 {
-	if (Character)
+	if (Character && PickupSound)
 	{
-		if (bForcePlaySound)
-		{
-			if (PickupSound)
-			{
-				UGameplayStatics::PlaySound2D(this, PickupSound);
-			}
-		}
-		else if (Character->ShouldPlayPickupSound())
-		{
-			Character->StartPickupSoundTimer();
-			if (PickupSound)
-			{
-				UGameplayStatics::PlaySound2D(this, PickupSound);
-			}
-		}
+		// pickups in quick succession are rate limited unless forced
+		UAudioEventSubsystem::PlaySound2D(this, EAudioEventCategory::EAEC_Pickup, PickupSound, bForcePlaySound);
 	}
 }
 
@@ -497,20 +485,9 @@ void AItem::DisableGlowMaterial()
 
 void AItem::PlayEquipSound(bool bForcePlaySound)
 {
-	if (Character)
+	if (Character && EquipSound)
 	{
-		if (bForcePlaySound)
-		{
-			UGameplayStatics::PlaySound2D(this, EquipSound);
-		}
-		else if (Character->ShouldPlayEquipSound())
-		{
-			Character->StartEquipSoundTimer();
-			if (PickupSound)
-			{
-				UGameplayStatics::PlaySound2D(this, EquipSound);
-			}
-		}
+		UAudioEventSubsystem::PlaySound2D(this, EAudioEventCategory::EAEC_Equip, EquipSound, bForcePlaySound);
 	}
 }
 
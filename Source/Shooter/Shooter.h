@@ -4,8 +4,13 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_STATS_GROUP(TEXT("Shooter"), STATGROUP_Shooter, STATCAT_Advanced);
+
 #define EPS_Metal EPhysicalSurface::SurfaceType1;
 #define EPS_Stone EPhysicalSurface::SurfaceType2;
 #define EPS_Tile  EPhysicalSurface::SurfaceType3;
 #define EPS_Grass EPhysicalSurface::SurfaceType4;
-#define EPS_Water EPhysicalSurface::SurfaceType5;
\ No newline at end of file
+#define EPS_Water EPhysicalSurface::SurfaceType5;
+
+// bullets - world geometry and enemy hitboxes block it, items and skeletal meshes don't
+#define ECC_Weapon ECollisionChannel::ECC_GameTraceChannel1
\ No newline at end of file
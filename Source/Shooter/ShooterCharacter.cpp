@@ -17,6 +17,7 @@
 #include "Components/SphereComponent.h"
 #include "Components/WidgetComponent.h"
 #include "Particles/ParticleSystemComponent.h"
+#include "Components/AudioComponent.h"
 #include "Components/WidgetComponent.h"
 #include <Shooter/Ammo.h>
 
@@ -26,7 +27,163 @@
 #include "Shooter.h"
 #include "BehaviorTree/BlackboardComponent.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
+#include "BallisticsSubsystem.h"
+#include "HitboxHistoryComponent.h"
+#include "CombatResolutionSubsystem.h"
+#include "FireModePolicies.h"
+#include "AllocationTracker.h"
+#include "FXPoolSubsystem.h"
+#include "TracerSubsystem.h"
+#include "EngineUtils.h"
+#include "ImpactSubsystem.h"
+#include "AudioEventSubsystem.h"
+#include "FootstepComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("SendBullet"), STAT_SendBullet, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("ResolvePendingShots"), STAT_ResolvePendingShots, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("ApplyShotHits"), STAT_ApplyShotHits, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crosshair trace requests"), STAT_CrosshairTraceRequests, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crosshair deprojections"), STAT_CrosshairDeprojections, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crosshair traces"), STAT_CrosshairTraces, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected hits"), STAT_RejectedHits, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire sound voice starts"), STAT_FireVoiceStarts, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarAsyncHitscan(
+	TEXT("shooter.AsyncHitscan"),
+	1,
+	TEXT("How hitscan weapon traces are run.\n")
+	TEXT("0: synchronous traces, hit applied on the same frame\n")
+	TEXT("1: async traces, hits resolved in one batch when the traces come back"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarValidateHits(
+	TEXT("shooter.ValidateHits"),
+	0,
+	TEXT("Server side hit validation.\n")
+	TEXT("0: hits are trusted\n")
+	TEXT("1: hits on actors with a hitbox history are retraced against their hitboxes at the shot time"),
+	ECVF_Default);
+
+// shots before the allocation test starts counting, pools and reused arrays fill up during these
+static constexpr int32 AllocationTestWarmupRounds = 64;
+// frames to wait after the last shot for its async traces to come back
+static constexpr int32 AllocationTestSettleFrames = 8;
+
+static FAutoConsoleCommandWithWorldAndArgs FiringAllocationTestCommand(
+	TEXT("shooter.FiringAllocationTest"),
+	TEXT("Holds the player's trigger so the fire schedule fires and reloads the equipped weapon, fails on any heap or UObject allocation made by the firing and reload paths.\n")
+	TEXT("Needs a build with stats.\n")
+	TEXT("shooter.FiringAllocationTest [Rounds=1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 Rounds = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000, 1);
+
+		APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		AShooterCharacter* ShooterCharacter = PlayerController ? Cast<AShooterCharacter>(PlayerController->GetPawn()) : nullptr;
+		if (ShooterCharacter == nullptr)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("FiringAllocationTest: needs a possessed shooter character"));
+			return;
+		}
+
+		ShooterCharacter->StartFiringAllocationTest(Rounds);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs HitscanBenchmarkCommand(
+	TEXT("shooter.HitscanBenchmark"),
+	TEXT("Traces the player's equipped weapon along the crosshair synchronously and through the async trace queue,\n")
+	TEXT("logs the game thread cost of both and whether they hit the same things. Aim at something that doesn't move.\n")
+	TEXT("shooter.HitscanBenchmark [Shots=100]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 Shots = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100, 1);
+
+		APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		AShooterCharacter* ShooterCharacter = PlayerController ? Cast<AShooterCharacter>(PlayerController->GetPawn()) : nullptr;
+		if (ShooterCharacter == nullptr)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("HitscanBenchmark: needs a possessed shooter character"));
+			return;
+		}
 
+		ShooterCharacter->StartHitscanBenchmark(Shots);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ShotgunBenchmarkCommand(
+	TEXT("shooter.ShotgunBenchmark"),
+	TEXT("Fires Pellets pellet shots of the player's equipped weapon into a crowd of enemies spawned in front of the camera\n")
+	TEXT("and logs the game thread cost per shot of tracing, merging the hits per enemy and resolving them.\n")
+	TEXT("shooter.ShotgunBenchmark [EnemyCount=30] [Shots=50] [Pellets=12]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 EnemyCount = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 30, 1);
+		const int32 Shots = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 50, 1);
+		const int32 Pellets = FMath::Max(Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 12, 1);
+
+		APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		AShooterCharacter* ShooterCharacter = PlayerController ? Cast<AShooterCharacter>(PlayerController->GetPawn()) : nullptr;
+		if (ShooterCharacter == nullptr)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ShotgunBenchmark: needs a possessed shooter character"));
+			return;
+		}
+
+		ShooterCharacter->RunShotgunBenchmark(EnemyCount, Shots, Pellets);
+	}));
+
+static FAutoConsoleCommand FireScheduleTestCommand(
+	TEXT("shooter.FireScheduleTest"),
+	TEXT("Steps the fire schedule at 20, 60 and 144 fps with the trigger pull before and after the pawn tick\n")
+	TEXT("and checks every shot time against a constant fire rate.\n")
+	TEXT("shooter.FireScheduleTest [FireRate=0.1] [Shots=30]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const float FireRate = FMath::Max(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 0.1f, 0.001f);
+		const int32 Shots = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 30, 2);
+
+		static const float FrameRates[] = { 20.f, 60.f, 144.f };
+		bool bPassed = true;
+		for (const float FrameRate : FrameRates)
+		{
+			for (int32 Order = 0; Order < 2; ++Order)
+			{
+				// the trigger pull fires the first shot on frame 0, before or after that frame's pawn tick
+				const bool bPullAfterTick = Order == 1;
+				const float DeltaTime = 1.f / FrameRate;
+
+				FFireSchedule Schedule;
+				Schedule.Start(FireRate, 0);
+				int32 ShotsFired = 1;
+				float MaxError = 0.f;
+				for (uint64 Frame = bPullAfterTick ? 1 : 0; ShotsFired < Shots; ++Frame)
+				{
+					Schedule.Advance(DeltaTime, Frame);
+					while (Schedule.IsShotDue() && ShotsFired < Shots)
+					{
+						const float ShotTime = Schedule.GetDueShotTime(Frame * DeltaTime);
+						MaxError = FMath::Max(MaxError, FMath::Abs(ShotTime - ShotsFired * FireRate));
+						Schedule.ConsumeShot(FireRate);
+						++ShotsFired;
+					}
+				}
+
+				// float time, a tenth of a millisecond is far below a frame
+				const bool bRunPassed = MaxError < 1.0e-4f;
+				bPassed &= bRunPassed;
+				UE_LOG(LogTemp, Log, TEXT("FireScheduleTest: %.0f fps, trigger pull %s the tick - worst shot time error %.4f ms%s"),
+					FrameRate, bPullAfterTick ? TEXT("after") : TEXT("before"), MaxError * 1000.f, bRunPassed ? TEXT("") : TEXT(" FAILED"));
+			}
+		}
+
+		if (bPassed)
+		{
+			UE_LOG(LogTemp, Log, TEXT("FireScheduleTest passed: %d shots at %.3f s land on the same times at every frame rate"), Shots, FireRate);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("FireScheduleTest FAILED: shot times depend on the frame rate"));
+		}
+	}));
 
 // Sets default values
 AShooterCharacter::AShooterCharacter()
@@ -65,6 +222,21 @@ AShooterCharacter::AShooterCharacter()
 	//AutomaticFireRate = 0.1f;
 	bShouldFire = true;
 	bFireButtonPressed = false;
+	FireModeFunction = nullptr;
+	ShotsInSequence = 0;
+	bFireLoopPlaying = false;
+	EquippedBarrelSocket = nullptr;
+	EquippedClipBoneIndex = INDEX_NONE;
+	AllocationTestShots = 0;
+	AllocationTestRounds = 0;
+	AllocationTestSettleFrame = 0;
+	NextShotId = 0;
+	HitscanBenchmark.ShotCount = 0;
+	HitscanBenchmark.OutstandingTraces = 0;
+	CrosshairView.FrameNumber = 0;
+	CrosshairView.bDeprojected = false;
+	CrosshairView.bTraced = false;
+	CrosshairView.AsyncTraceId = -1;
 
 	// item trace variables
 	bShouldTraceItems = false;
@@ -81,6 +253,7 @@ AShooterCharacter::AShooterCharacter()
 	// tarting ammo ammounts
 	Starting9mmAmmo = 32;
 	StartingARAmmo = 120;
+	StartingShellAmmo = 24;
 	// combat variables
 	CombatState = ECombatState::ECS_Unoccupited;
 	bCrouching = false;
@@ -91,9 +264,7 @@ AShooterCharacter::AShooterCharacter()
 	BaseGroundFriction = 2.f;
 	CrouchingGroundFriction = 100.f;
 	bAimingButtonPressed = false;
-	// pickip sound timer properties
-	bShouldPlayPickupSound = true;
-	bShouldPlayEquipSound = true;
+	// pickup and equip sound rate limits
 	PickupSoundResetTime = 0.2f;
 	EquipSoundResetTime = 0.2f;
 	// icon animation properties
@@ -155,6 +326,10 @@ AShooterCharacter::AShooterCharacter()
 	InterpComp6 = CreateDefaultSubobject<USceneComponent>(TEXT("InterpComp6"));
 	InterpComp6->SetupAttachment(GetFollowCamera());
 
+	HitboxHistory = CreateDefaultSubobject<UHitboxHistoryComponent>(TEXT("HitboxHistory"));
+
+	Footsteps = CreateDefaultSubobject<UFootstepComponent>(TEXT("Footsteps"));
+
 }
 
 float AShooterCharacter::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
@@ -170,7 +345,7 @@ float AShooterCharacter::TakeDamage(float DamageAmount, FDamageEvent const& Dama
 		AEnemyController* EnemyController = Cast<AEnemyController>(EventInstigator);
 		if (EnemyController)
 		{
-			EnemyController->GetBlacboardCompomponent()->SetValueAsBool(FName("CharacterDead"), true);
+			EnemyController->GetEnemyBlackboard().SetCharacterDead(true);
 		}
 	}
 	else
@@ -231,6 +406,49 @@ void AShooterCharacter::BeginPlay()
 	// create FinterpLocation structs
 	InitializeInterpLocations();
 
+	if (UFXPoolSubsystem* FXPool = GetWorld()->GetSubsystem<UFXPoolSubsystem>())
+	{
+		FXPool->Prewarm(ImapactParticles);
+		FXPool->Prewarm(BeamParticles);
+	}
+
+	UTracerSubsystem* Tracers = GetWorld()->GetSubsystem<UTracerSubsystem>();
+	if (Tracers && TracerMesh && !Tracers->HasTracerMesh())
+	{
+		Tracers->SetTracerMesh(TracerMesh, TracerMaterial);
+	}
+
+	UImpactSubsystem* Impacts = GetWorld()->GetSubsystem<UImpactSubsystem>();
+	if (Impacts && ImpactSurfaces && !Impacts->HasSurfaceTable())
+	{
+		Impacts->SetSurfaceTable(ImpactSurfaces);
+	}
+
+	if (UAudioEventSubsystem* AudioEvents = GetWorld()->GetSubsystem<UAudioEventSubsystem>())
+	{
+		AudioEvents->GetCategoryRules(EAudioEventCategory::EAEC_Pickup).MinInterval = PickupSoundResetTime;
+		AudioEvents->GetCategoryRules(EAudioEventCategory::EAEC_Equip).MinInterval = EquipSoundResetTime;
+	}
+
+	CrosshairTraceDelegate.BindUObject(this, &AShooterCharacter::OnCrosshairTraceCompleted);
+	WeaponTraceDelegate.BindUObject(this, &AShooterCharacter::OnWeaponTraceCompleted);
+	HitscanBenchmarkTraceDelegate.BindUObject(this, &AShooterCharacter::OnHitscanBenchmarkTraceCompleted);
+
+	// our own bullets start inside the capsule
+	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Weapon, ECR_Ignore);
+	GetMesh()->SetCollisionResponseToChannel(ECC_Weapon, ECR_Ignore);
+}
+
+void AShooterCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// the loop voice belongs to the pool and would keep playing
+	if (UAudioEventSubsystem* AudioEvents = GetWorld()->GetSubsystem<UAudioEventSubsystem>())
+	{
+		AudioEvents->StopLoop(FireLoopHandle);
+	}
+	bFireLoopPlaying = false;
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AShooterCharacter::MoveForward(float Value)
@@ -305,311 +523,1026 @@ void AShooterCharacter::PlayFireSound()
 {
 	if (EquippedWeapon->GetFireSound())
 	{
-		UGameplayStatics::PlaySound2D(this, EquippedWeapon->GetFireSound());
+		if (UAudioEventSubsystem::PlaySound2D(this, EAudioEventCategory::EAEC_WeaponFire, EquippedWeapon->GetFireSound()))
+		{
+			INC_DWORD_STAT(STAT_FireVoiceStarts);
+		}
 	}
 }
 
-void AShooterCharacter::SendBullet()
+void AShooterCharacter::SendBullet(float ShotTime)
 {
-	const USkeletalMeshSocket* BarrelSocket = EquippedWeapon->GetItemMesh()->GetSocketByName("BarrelSocket");
-	
-	if (BarrelSocket)
+	SCOPE_CYCLE_COUNTER(STAT_SendBullet);
+	FAllocationTracker::FScope AllocationScope;
+
+	if (EquippedBarrelSocket)
 	{
-		const FTransform SocketTransform = BarrelSocket->GetSocketTransform(EquippedWeapon->GetItemMesh());
+		const FTransform SocketTransform = EquippedBarrelSocket->GetSocketTransform(EquippedWeapon->GetItemMesh());
 
 		//UE_LOG(LogTemp, Warning, TEXT("BEFORE MuzzleFlash"));
 		if (EquippedWeapon->GetMuzzleFlash())
 		{
 			//UE_LOG(LogTemp, Warning, TEXT("MuzzleFlash"));
-			UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), EquippedWeapon->GetMuzzleFlash(), SocketTransform);
+			UFXPoolSubsystem::SpawnFXAtLocation(this, EquippedWeapon->GetMuzzleFlash(), SocketTransform);
+		}
+
+		if (EquippedWeapon->IsBallistic())
+		{
+			FireBallisticBullets(SocketTransform);
+			return;
 		}
 
-		FHitResult BeamHitResoult;
-		bool bBeamEnd = GetBeamEndLocation(SocketTransform.GetLocation(), BeamHitResoult);
+		if (CVarAsyncHitscan.GetValueOnGameThread() != 0)
+		{
+			// hits get applied in ResolvePendingShots() once all traces are back
+			QueueAsyncBullet(SocketTransform, ShotTime);
+			return;
+		}
 
-		if (bBeamEnd)
+		FVector BeamLocation;
+		if (GetBeamLocation(BeamLocation))
 		{
-			if (BeamHitResoult.Actor.IsValid())
+			FPelletEndArray PelletEnds;
+			GetPelletTraceEnds(EquippedWeapon, SocketTransform.GetLocation(), BeamLocation, PelletEnds);
+
+			FShotHitArray ShotHits;
+			TraceWeaponPellets(EquippedWeapon, SocketTransform.GetLocation(), PelletEnds, ShotHits);
+			ApplyShotHits(EquippedWeapon, SocketTransform, ShotHits, ShotTime);
+		}
+
+	}
+}
+
+void AShooterCharacter::ApplyShotHits(AWeapon* Weapon, const FTransform& SocketTransform, TArrayView<const FShotHit> ShotHits, float ShotTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ApplyShotHits);
+
+	const bool bValidateHits = HasAuthority() && CVarValidateHits.GetValueOnGameThread() != 0;
+
+	// damage and notifications are merged per target with the rest of the frame's hits
+	UCombatResolutionSubsystem* CombatResolution = GetWorld()->GetSubsystem<UCombatResolutionSubsystem>();
+	UFXPoolSubsystem* FXPool = GetWorld()->GetSubsystem<UFXPoolSubsystem>();
+	UTracerSubsystem* Tracers = GetWorld()->GetSubsystem<UTracerSubsystem>();
+	UImpactSubsystem* Impacts = GetWorld()->GetSubsystem<UImpactSubsystem>();
+
+	for (const FShotHit& ShotHit : ShotHits)
+	{
+		const FHitResult& PelletHit = ShotHit.HitResult;
+		AActor* HitActor = PelletHit.Actor.Get();
+		if (HitActor && bValidateHits && !ValidateShotHit(PelletHit, ShotTime))
+		{
+			INC_DWORD_STAT(STAT_RejectedHits);
+			continue;
+		}
+
+		if (HitActor)
+		{
+			int32 Damage = 0;
+			bool bHeadShot = false;
+
+			AEnemy* HitEnemy = Cast<AEnemy>(HitActor);
+			if (HitEnemy && Weapon)
 			{
-				UE_LOG(LogTemp, Warning, TEXT("Actor Name: %s"),*BeamHitResoult.GetActor()->GetName());
-				
-				IBulletHitInterface* BulletHitInterface = Cast<IBulletHitInterface>(BeamHitResoult.Actor.Get());
+				const FResolvedHitZone HitZone = HitEnemy->GetHitZone(PelletHit);
+				Damage = static_cast<int32>(Weapon->GetZoneDamage(HitZone.Zone) * HitZone.DamageMultiplier * ShotHit.DamageScale);
+				bHeadShot = HitZone.Zone == EHitZone::EHZ_Head;
 
-				if (BulletHitInterface)
-				{
-					BulletHitInterface->BulletHit_Implementation(BeamHitResoult, this, GetController());
-				}
+				UE_LOG(LogTemp, VeryVerbose, TEXT("Hit Component: %s"), *PelletHit.BoneName.ToString());
+			}
 
-				AEnemy* HitEnemy = Cast<AEnemy>(BeamHitResoult.Actor.Get());
-				if (HitEnemy)
-				{
-					int32 Damage = 0;
-					if (BeamHitResoult.BoneName.ToString() == HitEnemy->GetHeadBone())
-					{
-						// headshot
-						Damage = EquippedWeapon->GetHeadShotDamage();
-						UGameplayStatics::ApplyDamage(BeamHitResoult.Actor.Get(),
-							Damage,
-							GetController(),
-							this,
-							UDamageType::StaticClass()
-						);
-
-						HitEnemy->ShowHitNumber(Damage, BeamHitResoult.Location, true);
-					}
-					else
-					{
-						// bodyshots
-						Damage = EquippedWeapon->GetDamage();
-						UGameplayStatics::ApplyDamage(BeamHitResoult.Actor.Get(),
-							Damage,
-							GetController(),
-							this,
-							UDamageType::StaticClass()
-						);
-
-						HitEnemy->ShowHitNumber(Damage, BeamHitResoult.Location, false);
-					}
+			if (CombatResolution)
+			{
+				CombatResolution->QueueBulletHit(PelletHit, Damage, bHeadShot, this, GetController());
+			}
+		}
 
-					
-					
-					
-					UE_LOG(LogTemp, Warning, TEXT("Hit Component: %s"), *BeamHitResoult.BoneName.ToString());
-				}
+		// enemies and explosives play their own impact effects
+		if (HitActor == nullptr || !HitActor->Implements<UBulletHitInterface>())
+		{
+			if (Impacts && Impacts->HasSurfaceTable())
+			{
+				Impacts->SpawnImpact(PelletHit);
 			}
-			else
+			else if (ImapactParticles && FXPool)
 			{
-				if (ImapactParticles)
-				{
-					UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ImapactParticles, BeamHitResoult.Location);
-				}
+				FXPool->SpawnFX(ImapactParticles, PelletHit.Location);
 			}
+		}
+
+		if (ShotHit.bPelletEnd && Tracers && Tracers->HasTracerMesh())
+		{
+			Tracers->AddTracer(SocketTransform.GetLocation(), PelletHit.Location);
+		}
+		else if (ShotHit.bPelletEnd && FXPool)
+		{
+			static const FName BeamTargetName(TEXT("Target"));
+
+			const FFXHandle Beam = FXPool->SpawnFX(BeamParticles, SocketTransform);
+			FXPool->SetVectorParameter(Beam, BeamTargetName, PelletHit.Location);
+		}
+	}
+}
+
+void AShooterCharacter::FireBallisticBullets(const FTransform& SocketTransform)
+{
+	UBallisticsSubsystem* Ballistics = GetWorld()->GetSubsystem<UBallisticsSubsystem>();
+	FVector BeamLocation;
+	if (Ballistics == nullptr || !GetBeamLocation(BeamLocation))
+	{
+		return;
+	}
+
+	// pellets aim the same way as hitscan, they just take time to get there
+	const FVector MuzzleLocation = SocketTransform.GetLocation();
+	FPelletEndArray PelletEnds;
+	GetPelletTraceEnds(EquippedWeapon, MuzzleLocation, BeamLocation, PelletEnds);
+
+	for (const FVector& PelletEnd : PelletEnds)
+	{
+		const FVector Velocity = (PelletEnd - MuzzleLocation).GetSafeNormal() * EquippedWeapon->GetMuzzleVelocity();
+		Ballistics->FireBullet(this, EquippedWeapon, MuzzleLocation, Velocity);
+	}
+}
+
+void AShooterCharacter::ApplyBallisticHit(AWeapon* Weapon, const FVector& MuzzleLocation, const FHitResult& HitResult, float TraceTime)
+{
+	// validated where the target was when the segment was traced, not a frame later when it is applied
+	// with a tracer mesh the ballistics subsystem already drew the bullet in flight, otherwise the beam goes to the impact
+	const UTracerSubsystem* Tracers = GetWorld()->GetSubsystem<UTracerSubsystem>();
+	const FShotHit ShotHit{ HitResult, 1.f, Tracers == nullptr || !Tracers->HasTracerMesh() };
+	ApplyShotHits(Weapon, FTransform(MuzzleLocation), MakeArrayView(&ShotHit, 1), TraceTime);
+}
+
+bool AShooterCharacter::ValidateShotHit(const FHitResult& HitResult, float ShotTime) const
+{
+	const AActor* HitActor = HitResult.GetActor();
+	const UHitboxHistoryComponent* TargetHistory = HitActor ? HitActor->FindComponentByClass<UHitboxHistoryComponent>() : nullptr;
+	if (TargetHistory == nullptr)
+	{
+		// nothing recorded to check against
+		return true;
+	}
+
+	FHitboxRewindHit RewindHit;
+	return TargetHistory->RewindTrace(ShotTime, HitResult.TraceStart, HitResult.TraceEnd, RewindHit);
+}
+
+void AShooterCharacter::QueueAsyncBullet(const FTransform& SocketTransform, float ShotTime)
+{
+	FVector CrosshairTraceStart;
+	FVector CrosshairTraceEnd;
+	if (!GetCrosshairTraceRay(CrosshairTraceStart, CrosshairTraceEnd))
+	{
+		return;
+	}
+
+	FPendingShot& Shot = PendingShots.AddDefaulted_GetRef();
+	Shot.ShotId = NextShotId++;
+	Shot.Weapon = EquippedWeapon;
+	Shot.SocketTransform = SocketTransform;
+	Shot.ShotTime = ShotTime;
+	// beam ends at the far end of the crosshair trace unless the crosshair trace hits something
+	Shot.BeamEndLocation = CrosshairTraceEnd;
+	Shot.OutstandingTraces = 0;
+	Shot.bResolved = false;
+
+	// items are traced synchronously this frame anyway, the shot shares that trace instead of queueing its own
+	if (bShouldTraceItems && !CrosshairView.bTraced && CrosshairView.AsyncTraceId < 0)
+	{
+		FHitResult CrosshairHitResult;
+		FVector CrosshairHitLocation;
+		TraceUnderCrosHairs(CrosshairHitResult, CrosshairHitLocation);
+	}
+
+	if (CrosshairView.bTraced)
+	{
+		// crosshair was already traced this frame, go straight to the muzzle trace
+		Shot.bWaitingForCrosshair = false;
+		if (CrosshairView.HitResult.bBlockingHit)
+		{
+			Shot.BeamEndLocation = CrosshairView.HitResult.Location;
+		}
+		QueueAsyncWeaponTrace(Shot);
+		return;
+	}
+
+	Shot.bWaitingForCrosshair = true;
+
+	if (CrosshairView.AsyncTraceId >= 0)
+	{
+		// another shot already queued this frame's crosshair trace
+		Shot.CrosshairTraceId = static_cast<uint32>(CrosshairView.AsyncTraceId);
+		return;
+	}
+
+	Shot.CrosshairTraceId = Shot.ShotId;
+	CrosshairView.AsyncTraceId = Shot.ShotId;
+	INC_DWORD_STAT(STAT_CrosshairTraces);
+
+	GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+		CrosshairTraceStart,
+		CrosshairTraceEnd,
+		ECollisionChannel::ECC_Visibility,
+		FCollisionQueryParams::DefaultQueryParam,
+		FCollisionResponseParams::DefaultResponseParam,
+		&CrosshairTraceDelegate,
+		Shot.CrosshairTraceId);
+}
+
+void AShooterCharacter::OnCrosshairTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	const bool bCrosshairHit = TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit;
+
+	for (FPendingShot& Shot : PendingShots)
+	{
+		if (!Shot.bWaitingForCrosshair || Shot.CrosshairTraceId != TraceDatum.UserData)
+		{
+			continue;
+		}
+
+		if (bCrosshairHit)
+		{
+			// tentative beam location
+			Shot.BeamEndLocation = TraceDatum.OutHits[0].Location;
+		}
+
+		Shot.bWaitingForCrosshair = false;
+		QueueAsyncWeaponTrace(Shot);
+	}
+}
+
+void AShooterCharacter::QueueAsyncWeaponTrace(FPendingShot& Shot)
+{
+	// muzzle traces depend on the crosshair hit so they can only be queued once that is known
+	const FVector MuzzleLocation = Shot.SocketTransform.GetLocation();
+
+	FPelletEndArray PelletEnds;
+	GetPelletTraceEnds(Shot.Weapon.Get(), MuzzleLocation, Shot.BeamEndLocation, PelletEnds);
+
+	// all pellets go out together under the shot's id and are resolved together
+	Shot.OutstandingTraces = PelletEnds.Num();
+	QueueAsyncPelletTraces(Shot.Weapon.Get(), MuzzleLocation, PelletEnds, &WeaponTraceDelegate, Shot.ShotId);
+}
+
+void AShooterCharacter::QueueAsyncPelletTraces(const AWeapon* Weapon, const FVector& MuzzleSocketLocation, TArrayView<const FVector> PelletEnds, FTraceDelegate* Delegate, uint32 UserData)
+{
+	const EAsyncTraceType TraceType = Weapon && Weapon->IsPenetrating() ? EAsyncTraceType::Multi : EAsyncTraceType::Single;
+	const FCollisionQueryParams QueryParams = GetWeaponTraceParams(Weapon);
+
+	for (const FVector& PelletEnd : PelletEnds)
+	{
+		GetWorld()->AsyncLineTraceByChannel(TraceType,
+			MuzzleSocketLocation,
+			PelletEnd,
+			ECC_Weapon,
+			QueryParams,
+			GetWeaponTraceResponse(Weapon),
+			Delegate,
+			UserData);
+	}
+}
+
+void AShooterCharacter::OnWeaponTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	FPendingShot* Shot = FindPendingShot(TraceDatum.UserData);
+	if (Shot == nullptr)
+	{
+		return;
+	}
+
+	AddPelletHits(Shot->Weapon.Get(), TraceDatum.OutHits, Shot->ShotHits);
+
+	--Shot->OutstandingTraces;
+	Shot->bResolved = Shot->OutstandingTraces <= 0;
+}
+
+FPendingShot* AShooterCharacter::FindPendingShot(uint32 ShotId)
+{
+	return PendingShots.FindByPredicate([ShotId](const FPendingShot& Shot) { return Shot.ShotId == ShotId; });
+}
+
+void AShooterCharacter::ResolvePendingShots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ResolvePendingShots);
+
+	if (PendingShots.Num() == 0)
+	{
+		return;
+	}
+
+	FAllocationTracker::FScope AllocationScope;
+
+	// apply every shot whose traces came back this frame in one pass
+	for (const FPendingShot& Shot : PendingShots)
+	{
+		if (Shot.bResolved && Shot.ShotHits.Num() > 0)
+		{
+			ApplyShotHits(Shot.Weapon.Get(), Shot.SocketTransform, Shot.ShotHits, Shot.ShotTime);
+		}
+	}
+
+	PendingShots.RemoveAll([](const FPendingShot& Shot) { return Shot.bResolved; });
+}
+
+void AShooterCharacter::PlayGunfireMontage()
+{
+	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+	if (AnimInstance && HipFireMontage)
+	{
+		static const FName StartFireSectionName(TEXT("StartFire"));
+
+		//UE_LOG(LogTemp, Warning, TEXT("AnimInstance && HipFireMontage"));
+		// restarting the section keeps the playing montage instance instead of allocating a new one every shot
+		if (!AnimInstance->Montage_IsPlaying(HipFireMontage))
+		{
+			AnimInstance->Montage_Play(HipFireMontage);
+		}
+		AnimInstance->Montage_JumpToSection(StartFireSectionName, HipFireMontage);
+	}
+}
+
+void AShooterCharacter::ReloadButtonPressed()
+{
+	ReloadWeapon();
+}
+
+void AShooterCharacter::ReloadWeapon()
+{
+	if (CombatState != ECombatState::ECS_Unoccupited)
+	{
+		return;
+	}
+
+	
+	if (EquippedWeapon == nullptr)
+	{
+		return;
+	}
+
+	// do we have ammo of correct type?
+	if (CarryingAmmo() && !EquippedWeapon->ClipIsFull()) 
+	{
+
+		if (bAiming)
+		{
+			StopAiming();
+		}
+	
+		CombatState = ECombatState::ECS_Reloading;
+		
+		UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+		if (AnimInstance && ReloadMontage)
+		{
+			AnimInstance->Montage_Play(ReloadMontage);
+			AnimInstance->Montage_JumpToSection(EquippedWeapon->GetReloadMontageSection());
+		}
+	}
+	
+}
+
+bool AShooterCharacter::CarryingAmmo()
+{
+	if (EquippedWeapon == nullptr)
+	{
+		return false;
+	}
+
+	EAmmoType AmmoType = EquippedWeapon->GetAmmoType();
+
+	if (AmmoMap.Contains(AmmoType))
+	{
+		return AmmoMap[AmmoType] > 0;
+	}
+
+	return false;
+}
+
+void AShooterCharacter::GrabClip()
+{
+	if (EquippedWeapon == nullptr)
+	{
+		return;
+	}
+
+	if (HandSceneComponent == nullptr || EquippedClipBoneIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	FAllocationTracker::FScope AllocationScope;
+	static const FName LeftHandBoneName(TEXT("hand_l"));
+
+	ClipTransform = EquippedWeapon->GetItemMesh()->GetBoneTransform(EquippedClipBoneIndex);
+
+	FAttachmentTransformRules AttacmentRules = FAttachmentTransformRules(EAttachmentRule::KeepRelative, true);
+	HandSceneComponent->AttachToComponent(GetMesh(), AttacmentRules, LeftHandBoneName);
+	HandSceneComponent->SetWorldTransform(ClipTransform);
+
+	EquippedWeapon->SetMovingClip(true);
+}
+
+void AShooterCharacter::ReleaseClip()
+{
+	EquippedWeapon->SetMovingClip(false);
+}
+
+void AShooterCharacter::CrouchButtonPressed()
+{
+	if (!GetCharacterMovement()->IsFalling())
+	{
+		bCrouching = !bCrouching;
+	}
+
+	if (bCrouching)
+	{
+		GetCharacterMovement()->MaxWalkSpeed = CrouchMovementSpeed;
+		GetCharacterMovement()->GroundFriction = CrouchingGroundFriction;
+	}
+	else
+	{
+		GetCharacterMovement()->MaxWalkSpeed = BaseMovementSpeed;
+		GetCharacterMovement()->GroundFriction = BaseGroundFriction;
+	}
+}
+
+void AShooterCharacter::Jump()
+{
+	if (bCrouching)
+	{
+		bCrouching = false;
+		GetCharacterMovement()->MaxWalkSpeed = BaseMovementSpeed;
+	}
+	else
+	{
+		ACharacter::Jump();
+	}
+}
+
+void AShooterCharacter::InterpCapsuleHalfHeight(float DeltaTime)
+{
+	float TargetCapsuleHalfHeight;
+	if (bCrouching)
+	{
+		TargetCapsuleHalfHeight = CrouchingCapsuleHalfHeight;
+	}
+	else
+	{
+		TargetCapsuleHalfHeight = StandingCapsuleHalfHeight;
+	}
+
+	const float InterpHalfHeight = FMath::FInterpTo(GetCapsuleComponent()->GetScaledCapsuleHalfHeight(), TargetCapsuleHalfHeight, DeltaTime, 20.f);
+
+	// negative value if crouching
+	const float DeltaCapsuleHalfHeight = InterpHalfHeight - GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const FVector MeshOffset = FVector(0.f, 0.f, -DeltaCapsuleHalfHeight);
+	GetMesh()->AddLocalOffset(MeshOffset);
+
+	GetCapsuleComponent()->SetCapsuleHalfHeight(InterpHalfHeight);
+}
+
+void AShooterCharacter::FireWeapon()
+{
+	if (EquippedWeapon == nullptr)
+	{
+		return;
+	}
+
+	if (CombatState != ECombatState::ECS_Unoccupited)
+	{
+		return;
+	}
+
+	if (WeaponHasAmmo() && FireModeFunction)
+	{
+		const float ShotTime = GetWorld()->GetTimeSeconds();
+		if (EquippedWeapon->HasFireLoop())
+		{
+			StartFireLoop();
+		}
+
+		ShotsInSequence = 0;
+		(this->*FireModeFunction)(ShotTime);
+		StartFireSchedule();
+		
+		//StartCrosshairBulletFire(); // višak???
+	}
+		
+}
+
+void AShooterCharacter::FireShot(float ShotTime)
+{
+	// the allocation test counts from the first shot after its warm up
+	if (AllocationTestRounds > 0)
+	{
+		if (AllocationTestShots == AllocationTestWarmupRounds)
+		{
+			FAllocationTracker::Get().ResetTotals();
+		}
+		++AllocationTestShots;
+	}
+
+	// the loop already has this shot in it
+	if (!bFireLoopPlaying)
+	{
+		PlayFireSound();
+	}
+	SendBullet(ShotTime);
+	PlayGunfireMontage();
+
+	EquippedWeapon->DecrementAmmo();
+}
+
+template <typename TTriggerPolicy, typename TSlideRecoilPolicy>
+bool AShooterCharacter::FireScheduledShot(float ShotTime)
+{
+	// the first shot of a trigger pull always goes out
+	if (ShotsInSequence > 0 && !TTriggerPolicy::ShouldContinue(EquippedWeapon, bFireButtonPressed, ShotsInSequence))
+	{
+		return false;
+	}
+
+	FireShot(ShotTime);
+	TSlideRecoilPolicy::AfterShot(EquippedWeapon);
+	++ShotsInSequence;
+	return true;
+}
+
+void AShooterCharacter::BindFireMode()
+{
+	if (EquippedWeapon == nullptr)
+	{
+		FireModeFunction = nullptr;
+		return;
+	}
+
+	// the only place fire behaviour looks at the weapon type
+	const bool bPistolSlide = EquippedWeapon->GetWeaponType() == EWeaponType::EWT_Pistol;
+
+	if (EquippedWeapon->IsBurst())
+	{
+		FireModeFunction = bPistolSlide ? SelectFireMode<FBurstTrigger, FPistolSlideRecoil>() : SelectFireMode<FBurstTrigger, FNoSlideRecoil>();
+	}
+	else if (EquippedWeapon->GetAutomatic())
+	{
+		FireModeFunction = bPistolSlide ? SelectFireMode<FAutomaticTrigger, FPistolSlideRecoil>() : SelectFireMode<FAutomaticTrigger, FNoSlideRecoil>();
+	}
+	else
+	{
+		FireModeFunction = bPistolSlide ? SelectFireMode<FSemiAutoTrigger, FPistolSlideRecoil>() : SelectFireMode<FSemiAutoTrigger, FNoSlideRecoil>();
+	}
+}
+
+void AShooterCharacter::CacheWeaponSockets()
+{
+	static const FName BarrelSocketName(TEXT("BarrelSocket"));
+
+	EquippedBarrelSocket = nullptr;
+	EquippedClipBoneIndex = INDEX_NONE;
+
+	if (EquippedWeapon == nullptr)
+	{
+		return;
+	}
+
+	EquippedBarrelSocket = EquippedWeapon->GetItemMesh()->GetSocketByName(BarrelSocketName);
+	EquippedClipBoneIndex = EquippedWeapon->GetItemMesh()->GetBoneIndex(EquippedWeapon->GetClipBoneName());
+
+	if (UFXPoolSubsystem* FXPool = GetWorld()->GetSubsystem<UFXPoolSubsystem>())
+	{
+		FXPool->Prewarm(EquippedWeapon->GetMuzzleFlash());
+	}
+}
+
+void AShooterCharacter::StartFiringAllocationTest(int32 Rounds)
+{
+	if (EquippedWeapon == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FiringAllocationTest: no weapon equipped"));
+		return;
+	}
+
+	if (!FAllocationTracker::CanCountHeapAllocations())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FiringAllocationTest: unavailable, heap allocations are only counted in builds with stats"));
+		return;
+	}
+
+	// the carried ammo entry exists before counting starts, topping it up later doesn't allocate
+	AmmoMap.FindOrAdd(EquippedWeapon->GetAmmoType());
+
+	AllocationTestShots = 0;
+	AllocationTestRounds = Rounds;
+	AllocationTestSettleFrame = 0;
+	UE_LOG(LogTemp, Log, TEXT("FiringAllocationTest: firing %d warm up rounds and %d counted rounds"), AllocationTestWarmupRounds, Rounds);
+}
+
+void AShooterCharacter::UpdateFiringAllocationTest()
+{
+	if (AllocationTestRounds <= 0 || EquippedWeapon == nullptr)
+	{
+		return;
+	}
+
+	const int32 CountedRounds = AllocationTestShots - AllocationTestWarmupRounds;
+	if (CountedRounds < AllocationTestRounds)
+	{
+		// an empty magazine reloads through ReloadWeapon and the montage's GrabClip like the player's does,
+		// only the carried ammo is topped up
+		int32& CarriedAmmo = AmmoMap.FindChecked(EquippedWeapon->GetAmmoType());
+		CarriedAmmo = FMath::Max(CarriedAmmo, EquippedWeapon->GetMagazineCapacity());
+
+		// hold the trigger, the shots go through FireWeapon and the fire schedule like the player's do
+		bFireButtonPressed = true;
+		if (CombatState == ECombatState::ECS_Unoccupited)
+		{
+			FireWeapon();
+		}
+		return;
+	}
+
+	// let go, then wait for the async traces of the last shots to come back
+	if (AllocationTestSettleFrame == 0)
+	{
+		bFireButtonPressed = false;
+	}
+	if (AllocationTestSettleFrame++ < AllocationTestSettleFrames)
+	{
+		return;
+	}
+
+	const FAllocationTracker& Tracker = FAllocationTracker::Get();
+	const uint64 HeapAllocations = Tracker.GetHeapAllocations();
+	const uint64 ObjectAllocations = Tracker.GetObjectAllocations();
+
+	// a burst can finish after the last counted round, those rounds count too
+	const bool bPassed = ObjectAllocations == 0 && HeapAllocations == 0;
+	if (bPassed)
+	{
+		UE_LOG(LogTemp, Log, TEXT("FiringAllocationTest passed: %d rounds, %llu heap allocations, %llu UObject allocations"),
+			CountedRounds, HeapAllocations, ObjectAllocations);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("FiringAllocationTest FAILED: %d rounds, %llu heap allocations, %llu UObject allocations"),
+			CountedRounds, HeapAllocations, ObjectAllocations);
+	}
+
+	AllocationTestRounds = 0;
+}
+
+void AShooterCharacter::StartHitscanBenchmark(int32 Shots)
+{
+	if (EquippedWeapon == nullptr || EquippedBarrelSocket == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HitscanBenchmark: no weapon equipped"));
+		return;
+	}
+
+	if (HitscanBenchmark.OutstandingTraces > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HitscanBenchmark: still waiting for the last run"));
+		return;
+	}
 
-			UParticleSystemComponent* Beam = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), BeamParticles, SocketTransform);
-			if (Beam)
-			{
-				Beam->SetVectorParameter(FName("Target"), BeamHitResoult.Location);
-			}
+	FVector BeamLocation;
+	if (!GetBeamLocation(BeamLocation))
+	{
+		return;
+	}
 
-		}
+	// pellet spread is random, both modes trace the same ends
+	const FVector MuzzleLocation = EquippedBarrelSocket->GetSocketTransform(EquippedWeapon->GetItemMesh()).GetLocation();
+	HitscanBenchmark.Weapon = EquippedWeapon;
+	HitscanBenchmark.MuzzleLocation = MuzzleLocation;
+	HitscanBenchmark.ShotCount = Shots;
+	HitscanBenchmark.PelletEnds.Reset();
+	for (int32 Shot = 0; Shot < Shots; ++Shot)
+	{
+		FPelletEndArray PelletEnds;
+		GetPelletTraceEnds(EquippedWeapon, MuzzleLocation, BeamLocation, PelletEnds);
+		HitscanBenchmark.PelletEnds.Append(PelletEnds);
+	}
+
+	const int32 NumPellets = HitscanBenchmark.PelletEnds.Num();
+	HitscanBenchmark.SyncHits.Reset();
+	HitscanBenchmark.SyncHits.SetNum(NumPellets);
+	HitscanBenchmark.AsyncHits.Reset();
+	HitscanBenchmark.AsyncHits.SetNum(NumPellets);
 
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Pellet = 0; Pellet < NumPellets; ++Pellet)
+	{
+		TraceWeaponPellets(EquippedWeapon, MuzzleLocation, MakeArrayView(&HitscanBenchmark.PelletEnds[Pellet], 1), HitscanBenchmark.SyncHits[Pellet]);
 	}
-}
+	HitscanBenchmark.SyncMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
 
-void AShooterCharacter::PlayGunfireMontage()
-{
-	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
-	if (AnimInstance && HipFireMontage)
+	// async costs the game thread the queuing here and the result handling when the traces come back next frame
+	HitscanBenchmark.OutstandingTraces = NumPellets;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Pellet = 0; Pellet < NumPellets; ++Pellet)
 	{
-		//UE_LOG(LogTemp, Warning, TEXT("AnimInstance && HipFireMontage"));
-		AnimInstance->Montage_Play(HipFireMontage);
-		AnimInstance->Montage_JumpToSection(FName("StartFire"));
+		QueueAsyncPelletTraces(EquippedWeapon, MuzzleLocation, MakeArrayView(&HitscanBenchmark.PelletEnds[Pellet], 1), &HitscanBenchmarkTraceDelegate, Pellet);
 	}
+	HitscanBenchmark.AsyncMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
 }
 
-void AShooterCharacter::ReloadButtonPressed()
+void AShooterCharacter::OnHitscanBenchmarkTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
 {
-	ReloadWeapon();
-}
+	const double StartTime = FPlatformTime::Seconds();
 
-void AShooterCharacter::ReloadWeapon()
-{
-	if (CombatState != ECombatState::ECS_Unoccupited)
+	const int32 Pellet = static_cast<int32>(TraceDatum.UserData);
+	if (!HitscanBenchmark.AsyncHits.IsValidIndex(Pellet))
 	{
 		return;
 	}
 
-	
-	if (EquippedWeapon == nullptr)
+	AddPelletHits(HitscanBenchmark.Weapon.Get(), TraceDatum.OutHits, HitscanBenchmark.AsyncHits[Pellet]);
+	HitscanBenchmark.AsyncMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	if (--HitscanBenchmark.OutstandingTraces == 0)
 	{
-		return;
+		FinishHitscanBenchmark();
 	}
+}
 
-	// do we have ammo of correct type?
-	if (CarryingAmmo() && !EquippedWeapon->ClipIsFull()) 
+void AShooterCharacter::FinishHitscanBenchmark()
+{
+	// same things hit in the same order at the same places
+	int32 MismatchedPellets = 0;
+	for (int32 Pellet = 0; Pellet < HitscanBenchmark.PelletEnds.Num(); ++Pellet)
 	{
+		const FShotHitArray& SyncHits = HitscanBenchmark.SyncHits[Pellet];
+		const FShotHitArray& AsyncHits = HitscanBenchmark.AsyncHits[Pellet];
 
-		if (bAiming)
+		bool bMatch = SyncHits.Num() == AsyncHits.Num();
+		for (int32 Index = 0; bMatch && Index < SyncHits.Num(); ++Index)
 		{
-			StopAiming();
+			const FHitResult& SyncHit = SyncHits[Index].HitResult;
+			const FHitResult& AsyncHit = AsyncHits[Index].HitResult;
+			bMatch = SyncHit.Component == AsyncHit.Component && SyncHit.ImpactPoint.Equals(AsyncHit.ImpactPoint, 1.f);
 		}
-	
-		CombatState = ECombatState::ECS_Reloading;
-		
-		UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
-		if (AnimInstance && ReloadMontage)
+
+		if (!bMatch)
 		{
-			AnimInstance->Montage_Play(ReloadMontage);
-			AnimInstance->Montage_JumpToSection(EquippedWeapon->GetReloadMontageSection());
+			++MismatchedPellets;
 		}
 	}
-	
-}
 
-bool AShooterCharacter::CarryingAmmo()
-{
-	if (EquippedWeapon == nullptr)
+	const int32 Shots = HitscanBenchmark.ShotCount;
+	if (MismatchedPellets == 0)
 	{
-		return false;
+		UE_LOG(LogTemp, Log, TEXT("HitscanBenchmark: %d shots, %d pellets, same hits in both modes - sync %.3f ms (%.4f per shot), async %.3f ms (%.4f per shot) on the game thread"),
+			Shots, HitscanBenchmark.PelletEnds.Num(), HitscanBenchmark.SyncMs, HitscanBenchmark.SyncMs / Shots, HitscanBenchmark.AsyncMs, HitscanBenchmark.AsyncMs / Shots);
 	}
-
-	EAmmoType AmmoType = EquippedWeapon->GetAmmoType();
-
-	if (AmmoMap.Contains(AmmoType))
+	else
 	{
-		return AmmoMap[AmmoType] > 0;
+		UE_LOG(LogTemp, Error, TEXT("HitscanBenchmark: %d shots, %d of %d pellets hit different things in the two modes - sync %.3f ms, async %.3f ms on the game thread"),
+			Shots, MismatchedPellets, HitscanBenchmark.PelletEnds.Num(), HitscanBenchmark.SyncMs, HitscanBenchmark.AsyncMs);
 	}
 
-	return false;
+	HitscanBenchmark.PelletEnds.Reset();
+	HitscanBenchmark.SyncHits.Reset();
+	HitscanBenchmark.AsyncHits.Reset();
 }
 
-void AShooterCharacter::GrabClip()
+void AShooterCharacter::RunShotgunBenchmark(int32 EnemyCount, int32 Shots, int32 Pellets)
 {
-	if (EquippedWeapon == nullptr)
+	UCombatResolutionSubsystem* CombatResolution = GetWorld()->GetSubsystem<UCombatResolutionSubsystem>();
+	APlayerController* PlayerController = Cast<APlayerController>(GetController());
+	if (EquippedWeapon == nullptr || EquippedBarrelSocket == nullptr || CombatResolution == nullptr || PlayerController == nullptr || PlayerController->PlayerCameraManager == nullptr)
 	{
+		UE_LOG(LogTemp, Warning, TEXT("ShotgunBenchmark: no weapon equipped"));
 		return;
 	}
 
-	if (HandSceneComponent == nullptr)
+	TActorIterator<AEnemy> It(GetWorld());
+	if (!It)
 	{
+		UE_LOG(LogTemp, Warning, TEXT("ShotgunBenchmark: needs at least one enemy in the level"));
 		return;
 	}
+	UClass* EnemyClass = It->GetClass();
 
-	int32 ClipBoneIndex = EquippedWeapon->GetItemMesh()->GetBoneIndex(EquippedWeapon->GetClipBoneName());
-	ClipTransform = EquippedWeapon->GetItemMesh()->GetBoneTransform(ClipBoneIndex);
-
-	FAttachmentTransformRules AttacmentRules = FAttachmentTransformRules(EAttachmentRule::KeepRelative, true);
-	HandSceneComponent->AttachToComponent(GetMesh(), AttacmentRules, FName(TEXT("hand_l")));
-	HandSceneComponent->SetWorldTransform(ClipTransform);
+	// a tight crowd in front of the camera, most pellets hit someone and enemies take several pellets each
+	const FVector CameraLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+	const FRotationMatrix CameraAxes(FRotator(0.f, PlayerController->PlayerCameraManager->GetCameraRotation().Yaw, 0.f));
+	const int32 Columns = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(EnemyCount)));
+	TArray<AEnemy*> Crowd;
+	for (int32 Index = 0; Index < EnemyCount; ++Index)
+	{
+		const FVector Location = CameraLocation
+			+ CameraAxes.GetUnitAxis(EAxis::X) * (800.f + (Index / Columns) * 120.f)
+			+ CameraAxes.GetUnitAxis(EAxis::Y) * ((Index % Columns) - Columns / 2) * 100.f;
 
-	EquippedWeapon->SetMovingClip(true);
-}
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		AEnemy* Enemy = GetWorld()->SpawnActor<AEnemy>(EnemyClass, Location, FRotator::ZeroRotator, SpawnParameters);
+		if (Enemy)
+		{
+			Crowd.Add(Enemy);
+		}
+	}
 
-void AShooterCharacter::ReleaseClip()
-{
-	EquippedWeapon->SetMovingClip(false);
-}
+	const FTransform SocketTransform = EquippedBarrelSocket->GetSocketTransform(EquippedWeapon->GetItemMesh());
+	const FVector MuzzleLocation = SocketTransform.GetLocation();
+	const FVector CrowdCenter = CameraLocation + CameraAxes.GetUnitAxis(EAxis::X) * (800.f + Columns * 60.f);
+	const FVector TraceDirection = (CrowdCenter - MuzzleLocation).GetSafeNormal();
+	const float TraceLength = FVector::Dist(CrowdCenter, MuzzleLocation) * 2.f;
+	const float ConeHalfAngle = FMath::DegreesToRadians(EquippedWeapon->GetPelletSpread() > 0.f ? EquippedWeapon->GetPelletSpread() : 5.f);
 
-void AShooterCharacter::CrouchButtonPressed()
-{
-	if (!GetCharacterMovement()->IsFalling())
+	double TotalMs = 0.0;
+	int32 PelletHits = 0;
+	int32 EnemiesHit = 0;
+	FPelletEndArray PelletEnds;
+	FShotHitArray ShotHits;
+	TArray<const AActor*, TInlineAllocator<16>> HitActors;
+	for (int32 Shot = 0; Shot < Shots; ++Shot)
 	{
-		bCrouching = !bCrouching;
+		PelletEnds.Reset();
+		for (int32 Pellet = 0; Pellet < Pellets; ++Pellet)
+		{
+			PelletEnds.Add(MuzzleLocation + FMath::VRandCone(TraceDirection, ConeHalfAngle) * TraceLength);
+		}
+		ShotHits.Reset();
+
+		// same path as a synchronous shot, ApplyDamage, hit number and impact sound go out once per enemy
+		const double StartTime = FPlatformTime::Seconds();
+		TraceWeaponPellets(EquippedWeapon, MuzzleLocation, PelletEnds, ShotHits);
+		ApplyShotHits(EquippedWeapon, SocketTransform, ShotHits, GetWorld()->GetTimeSeconds());
+		CombatResolution->ResolveHits();
+		TotalMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		HitActors.Reset();
+		for (const FShotHit& ShotHit : ShotHits)
+		{
+			const AActor* HitActor = ShotHit.HitResult.GetActor();
+			if (Cast<AEnemy>(HitActor))
+			{
+				++PelletHits;
+				HitActors.AddUnique(HitActor);
+			}
+		}
+		EnemiesHit += HitActors.Num();
+
+		// keep the crowd standing, a dying enemy doesn't take hits the same way
+		for (AEnemy* Enemy : Crowd)
+		{
+			Enemy->SetHealth(Enemy->GetMaxHealth());
+		}
 	}
 
-	if (bCrouching)
+	UE_LOG(LogTemp, Log, TEXT("ShotgunBenchmark: %d enemies, %d shots of %d pellets - %.1f pellet hits on %.1f enemies per shot, %.3f ms per shot on the game thread"),
+		Crowd.Num(), Shots, Pellets, static_cast<float>(PelletHits) / Shots, static_cast<float>(EnemiesHit) / Shots, TotalMs / Shots);
+
+	for (AEnemy* Enemy : Crowd)
 	{
-		GetCharacterMovement()->MaxWalkSpeed = CrouchMovementSpeed;
-		GetCharacterMovement()->GroundFriction = CrouchingGroundFriction;
+		Enemy->Destroy();
 	}
-	else
+}
+
+bool AShooterCharacter::GetBeamLocation(FVector& OutBeamLocation)
+{
+	FVector CrosshairTraceStart;
+	if (!GetCrosshairTraceRay(CrosshairTraceStart, OutBeamLocation))
 	{
-		GetCharacterMovement()->MaxWalkSpeed = BaseMovementSpeed;
-		GetCharacterMovement()->GroundFriction = BaseGroundFriction;
+		return false;
 	}
+
+	// check for crosshair hit, OutBeamLocation stays at the end of the trace if nothing is hit
+	FHitResult CrosshairHitResoult;
+	TraceUnderCrosHairs(CrosshairHitResoult, OutBeamLocation);
+
+	return true;
 }
 
-void AShooterCharacter::Jump()
+void AShooterCharacter::TraceWeaponPellets(AWeapon* Weapon, const FVector& MuzzleSocketLocation, TArrayView<const FVector> PelletEnds, FShotHitArray& OutShotHits)
 {
-	if (bCrouching)
+	// performn second trace, this from cijev od puške
+	// the scene query API has no multi ray call, the pellets are traced back to back here and the async path
+	// queues them all under one shot id so they come back and are resolved together
+	if (Weapon && Weapon->IsPenetrating())
 	{
-		bCrouching = false;
-		GetCharacterMovement()->MaxWalkSpeed = BaseMovementSpeed;
+		const FCollisionQueryParams QueryParams = GetWeaponTraceParams(Weapon);
+		for (const FVector& PelletEnd : PelletEnds)
+		{
+			PenetrationTraceHits.Reset();
+			GetWorld()->LineTraceMultiByChannel(PenetrationTraceHits, MuzzleSocketLocation, PelletEnd, ECC_Weapon, QueryParams, GetWeaponTraceResponse(Weapon));
+			AddPelletHits(Weapon, PenetrationTraceHits, OutShotHits);
+		}
+		return;
 	}
-	else
+
+	const FCollisionQueryParams QueryParams = GetWeaponTraceParams(Weapon);
+	for (const FVector& PelletEnd : PelletEnds)
 	{
-		ACharacter::Jump();
+		FHitResult PelletHit;
+		if (GetWorld()->LineTraceSingleByChannel(PelletHit, MuzzleSocketLocation, PelletEnd, ECC_Weapon, QueryParams))
+		{
+			OutShotHits.Add(FShotHit{ PelletHit, 1.f, true });
+		}
 	}
 }
 
-void AShooterCharacter::InterpCapsuleHalfHeight(float DeltaTime)
+FCollisionQueryParams AShooterCharacter::GetWeaponTraceParams(const AWeapon* Weapon) const
 {
-	float TargetCapsuleHalfHeight;
-	if (bCrouching)
-	{
-		TargetCapsuleHalfHeight = CrouchingCapsuleHalfHeight;
-	}
-	else
+	// physical material is needed for surface impacts and penetration cost
+	if (Weapon == nullptr || !Weapon->IsPenetrating())
 	{
-		TargetCapsuleHalfHeight = StandingCapsuleHalfHeight;
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(WeaponTrace), false);
+		QueryParams.bReturnPhysicalMaterial = true;
+		return QueryParams;
 	}
 
-	const float InterpHalfHeight = FMath::FInterpTo(GetCapsuleComponent()->GetScaledCapsuleHalfHeight(), TargetCapsuleHalfHeight, DeltaTime, 20.f);
-
-	// negative value if crouching
-	const float DeltaCapsuleHalfHeight = InterpHalfHeight - GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
-	const FVector MeshOffset = FVector(0.f, 0.f, -DeltaCapsuleHalfHeight);
-	GetMesh()->AddLocalOffset(MeshOffset);
+	// overlap traces also report what they start in, so the shooter has to be ignored
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(WeaponPenetrationTrace), false, this);
+	QueryParams.bReturnPhysicalMaterial = true;
+	return QueryParams;
+}
 
-	GetCapsuleComponent()->SetCapsuleHalfHeight(InterpHalfHeight);
+const FCollisionResponseParams& AShooterCharacter::GetWeaponTraceResponse(const AWeapon* Weapon) const
+{
+	// nothing blocks the penetrating trace, it returns every touch along the whole path sorted by distance
+	static const FCollisionResponseParams PenetrationResponse(ECR_Overlap);
+	return Weapon && Weapon->IsPenetrating() ? PenetrationResponse : FCollisionResponseParams::DefaultResponseParam;
 }
 
-void AShooterCharacter::FireWeapon()
+void AShooterCharacter::AddPelletHits(const AWeapon* Weapon, TArrayView<const FHitResult> TraceHits, FShotHitArray& OutShotHits) const
 {
-	if (EquippedWeapon == nullptr)
+	if (Weapon == nullptr || !Weapon->IsPenetrating())
 	{
+		if (TraceHits.Num() > 0 && TraceHits[0].bBlockingHit)
+		{
+			OutShotHits.Add(FShotHit{ TraceHits[0], 1.f, true });
+		}
 		return;
 	}
 
-	if (CombatState != ECombatState::ECS_Unoccupited)
-	{
-		return;
-	}
+	const int32 FirstPelletHit = OutShotHits.Num();
+	const float PenetrationPower = Weapon->GetPenetrationPower();
+	float RemainingPower = PenetrationPower;
+	const UPrimitiveComponent* PreviousComponent = nullptr;
+	const AActor* PreviousActor = nullptr;
 
-	if (WeaponHasAmmo())
+	for (const FHitResult& TraceHit : TraceHits)
 	{
-		PlayFireSound();
-		SendBullet();
-		PlayGunfireMontage();
+		// only things that would block a normal weapon trace count, trigger volumes overlap everything
+		const UPrimitiveComponent* HitComponent = TraceHit.GetComponent();
+		if (HitComponent == nullptr || HitComponent->GetCollisionResponseToChannel(ECC_Weapon) != ECR_Block)
+		{
+			continue;
+		}
+
+		// a skeletal mesh reports one touch per body, the bullet goes through an actor once and the entry hit counts
+		const AActor* HitActor = TraceHit.GetActor();
+		if (HitComponent == PreviousComponent || (HitActor && HitActor == PreviousActor))
+		{
+			continue;
+		}
+		PreviousComponent = HitComponent;
+		PreviousActor = HitActor;
 
-		EquippedWeapon->DecrementAmmo();
-		StartFireTimer();
+		OutShotHits.Add(FShotHit{ TraceHit, RemainingPower / PenetrationPower, false });
 
-		if (EquippedWeapon->GetWeaponType() == EWeaponType::EWT_Pistol)
+		RemainingPower -= Weapon->GetPenetrationCost(UPhysicalMaterial::DetermineSurfaceType(TraceHit.PhysMaterial.Get()));
+		if (RemainingPower <= 0.f)
 		{
-			// start moving slide timer
-			EquippedWeapon->StartSlideTimer();
+			break;
 		}
-		
-		//StartCrosshairBulletFire(); // višak???
 	}
-		
+
+	if (OutShotHits.Num() > FirstPelletHit)
+	{
+		OutShotHits.Last().bPelletEnd = true;
+	}
 }
 
-bool AShooterCharacter::GetBeamEndLocation(const FVector& MuzlleSocketLocation, FHitResult& OutHitResoult)
+void AShooterCharacter::GetPelletTraceEnds(const AWeapon* Weapon, const FVector& MuzzleSocketLocation, const FVector& BeamLocation, FPelletEndArray& OutPelletEnds) const
 {
-	FVector OutBeamLocation;
-	
-	// check for crosshair hit
-	FHitResult CrosshairHitResoult;
-	bool bCrosshairHit = TraceUnderCrosHairs(CrosshairHitResoult, OutBeamLocation);
+	const FVector WeaponTraceEnd = GetWeaponTraceEnd(MuzzleSocketLocation, BeamLocation);
+	const int32 PelletCount = Weapon ? FMath::Max(Weapon->GetPelletCount(), 1) : 1;
 
-	if (bCrosshairHit)
-	{
-		// tentative beam location
-		OutBeamLocation = CrosshairHitResoult.Location;
-	}
-	else // co crosshait hit
+	if (PelletCount == 1)
 	{
-		// outbeamlocation is the End location for the line trace
+		OutPelletEnds.Add(WeaponTraceEnd);
+		return;
 	}
 
-	// performn second trace, this from cijev od puške
-
-	const FVector WeaponTraceStart = MuzlleSocketLocation;
-	const FVector StartToEnd = OutBeamLocation - MuzlleSocketLocation;
-	const FVector WeaponTraceEnd = MuzlleSocketLocation + (StartToEnd * 1.25f);
-	GetWorld()->LineTraceSingleByChannel(OutHitResoult, WeaponTraceStart, WeaponTraceEnd, ECC_Visibility);
+	// spread pellets in a cone around the muzzle -> crosshair direction
+	const FVector StartToEnd = WeaponTraceEnd - MuzzleSocketLocation;
+	const float TraceLength = StartToEnd.Size();
+	const FVector TraceDirection = StartToEnd.GetSafeNormal();
+	const float ConeHalfAngle = FMath::DegreesToRadians(Weapon->GetPelletSpread());
 
-	if (!OutHitResoult.bBlockingHit)
+	for (int32 i = 0; i < PelletCount; ++i)
 	{
-		OutHitResoult.Location = OutBeamLocation;
-		return  false;
+		OutPelletEnds.Add(MuzzleSocketLocation + FMath::VRandCone(TraceDirection, ConeHalfAngle) * TraceLength);
 	}
+}
 
-	return true;
-
-
+FVector AShooterCharacter::GetWeaponTraceEnd(const FVector& MuzzleSocketLocation, const FVector& BeamLocation) const
+{
+	const FVector StartToEnd = BeamLocation - MuzzleSocketLocation;
+	return MuzzleSocketLocation + (StartToEnd * 1.25f);
 }
 
 void AShooterCharacter::Aim()
@@ -799,47 +1732,7 @@ void AShooterCharacter::HighlightInventorySlot()
 
 EPhysicalSurface AShooterCharacter::GetSurfaceType()
 {
-	FHitResult HitResult;
-	const FVector Start = GetActorLocation();
-	const FVector End = Start + FVector(0.f, 0.f, -400.f);
-	FCollisionQueryParams QueryParams;
-	QueryParams.bReturnPhysicalMaterial = true;
-	
-	GetWorld()->LineTraceSingleByChannel(HitResult, Start, End, ECollisionChannel::ECC_Visibility, QueryParams);
-	
-	//UE_LOG(LogTemp, Warning, TEXT("Hit Actor: %s"), *HitResult.Actor->GetName());
-
-	//EPhysicalSurface HitSurface = HitResult.PhysMaterial.Get()->SurfaceType;
-
-	//if (HitSurface)
-	//{
-	//	UE_LOG(LogTemp, Warning, TEXT("HHITSURFACE"));
-	//}
-	//
-
-	//if (HitSurface == EPhysicalSurface::SurfaceType1) // grass
-	//{
-	//	UE_LOG(LogTemp, Warning, TEXT("Hit SurfaceType1 surface type"));
-	//}
-	//if (HitSurface == EPhysicalSurface::SurfaceType2) // grass
-	//{
-	//	UE_LOG(LogTemp, Warning, TEXT("Hit SurfaceType2 surface type"));
-	//}
-	//if (HitSurface == EPhysicalSurface::SurfaceType3) // grass
-	//{
-	//	UE_LOG(LogTemp, Warning, TEXT("Hit SurfaceType3 surface type"));
-	//}
-	//if (HitSurface == EPhysicalSurface::SurfaceType4) // grass
-	//{
-	//	UE_LOG(LogTemp, Warning, TEXT("Hit SurfaceType4 surface type"));
-	//}
-	//if (HitSurface == EPhysicalSurface::SurfaceType_Default) // grass
-	//{
-	//	UE_LOG(LogTemp, Warning, TEXT("Hit SurfaceType_Default surface type"));
-	//}
-
-	return  UPhysicalMaterial::DetermineSurfaceType(HitResult.PhysMaterial.Get());
-	
+	return Footsteps ? Footsteps->GetSurfaceType() : SurfaceType_Default;
 }
 
 void AShooterCharacter::EndStun()
@@ -903,18 +1796,6 @@ void AShooterCharacter::IncrementInterpLocItemCount(int32 Index, int32 Amount)
 	}
 }
 
-void AShooterCharacter::StartPickupSoundTimer()
-{
-	bShouldPlayPickupSound = false;
-	GetWorldTimerManager().SetTimer(PickupSoundTimer, this, &AShooterCharacter::ResetPickupSoundTimer, PickupSoundResetTime);
-}
-
-void AShooterCharacter::StartEquipSoundTimer()
-{
-	bShouldPlayEquipSound = false;
-	GetWorldTimerManager().SetTimer(EquipSoundTimer, this, &AShooterCharacter::ResetEquipSoundTimer, PickupSoundResetTime);
-}
-
 void AShooterCharacter::AimingButtonReleased()
 {
 	bAimingButtonPressed = false;
@@ -1014,7 +1895,7 @@ void AShooterCharacter::FireButtonReleased()
 	bFireButtonPressed = false;
 }
 
-void AShooterCharacter::StartFireTimer()
+void AShooterCharacter::StartFireSchedule()
 {
 	if (EquippedWeapon == nullptr)
 	{
@@ -1022,40 +1903,136 @@ void AShooterCharacter::StartFireTimer()
 	}
 
 	CombatState = ECombatState::ECS_FireTimerInProgress;
-	GetWorldTimerManager().SetTimer(AutoFireTimer, this, &AShooterCharacter::AutoFireReset, EquippedWeapon->GetAutoFireRate());
+	FireSchedule.Start(EquippedWeapon->GetAutoFireRate(), GFrameCounter);
+}
 
+void AShooterCharacter::UpdateFireSchedule(float DeltaTime)
+{
+	if (CombatState != ECombatState::ECS_FireTimerInProgress)
+	{
+		// schedule was interrupted (reload, equip, stun...)
+		StopFireLoop();
+		return;
+	}
+
+	if (EquippedWeapon == nullptr || FireModeFunction == nullptr)
+	{
+		CombatState = ECombatState::ECS_Unoccupited;
+		StopFireLoop();
+		return;
+	}
 
+	// several shots can come due in one frame when the fire rate is shorter than the frame time
+	const float FireRate = FMath::Max(EquippedWeapon->GetAutoFireRate(), KINDA_SMALL_NUMBER);
+	const float FrameTime = GetWorld()->GetTimeSeconds();
+	FireSchedule.Advance(DeltaTime, GFrameCounter);
+
+	while (FireSchedule.IsShotDue())
+	{
+		if (!WeaponHasAmmo())
+		{
+			CombatState = ECombatState::ECS_Unoccupited;
+			StopFireLoop();
+			// reload weapon
+			ReloadButtonPressed();
+			return;
+		}
+
+		if (!(this->*FireModeFunction)(FireSchedule.GetDueShotTime(FrameTime)))
+		{
+			CombatState = ECombatState::ECS_Unoccupited;
+			StopFireLoop();
+			return;
+		}
+		FireSchedule.ConsumeShot(FireRate);
+	}
 }
 
-void AShooterCharacter::AutoFireReset()
+void AShooterCharacter::StartFireLoop()
 {
-	if (CombatState == ECombatState::ECS_Stunned)
+	UAudioEventSubsystem* AudioEvents = GetWorld()->GetSubsystem<UAudioEventSubsystem>();
+	if (bFireLoopPlaying || AudioEvents == nullptr)
 	{
 		return;
 	}
 
-	CombatState = ECombatState::ECS_Unoccupited;
+	// pitch the loop so its shots land on the fire schedule, the engine clamps pitch to 0.4 - 2
+	const float FireRate = EquippedWeapon->GetAutoFireRate();
+	const float LoopShotInterval = EquippedWeapon->GetFireLoopShotInterval();
+	const float Pitch = LoopShotInterval > 0.f && FireRate > 0.f ? LoopShotInterval / FireRate : 1.f;
 
-	if (EquippedWeapon == nullptr)
+	// the loop's first shot is the trigger pull shot, which is fired this frame; when the pool has no
+	// voice left the shots play their own sounds
+	FireLoopHandle = AudioEvents->PlayLoop2D(EAudioEventCategory::EAEC_WeaponFire, EquippedWeapon->GetFireLoopSound(), Pitch);
+	if (FireLoopHandle.IsValid())
+	{
+		bFireLoopPlaying = true;
+		INC_DWORD_STAT(STAT_FireVoiceStarts);
+	}
+}
+
+void AShooterCharacter::StopFireLoop()
+{
+	if (!bFireLoopPlaying)
 	{
 		return;
 	}
 
-	if (WeaponHasAmmo())
+	bFireLoopPlaying = false;
+	if (UAudioEventSubsystem* AudioEvents = GetWorld()->GetSubsystem<UAudioEventSubsystem>())
 	{
-		if (bFireButtonPressed && EquippedWeapon->GetAutomatic())
-		{
-			FireWeapon();
-		}
-	} else
+		AudioEvents->StopLoop(FireLoopHandle, 0.05f);
+	}
+
+	if (EquippedWeapon && EquippedWeapon->GetFireTailSound()
+		&& UAudioEventSubsystem::PlaySound2D(this, EAudioEventCategory::EAEC_WeaponFire, EquippedWeapon->GetFireTailSound()))
 	{
-		// reload weapon
-		ReloadButtonPressed();
+		INC_DWORD_STAT(STAT_FireVoiceStarts);
 	}
 }
 
 bool AShooterCharacter::TraceUnderCrosHairs(FHitResult& OutHitResult, FVector& OutHitLocation)
 {
+	INC_DWORD_STAT(STAT_CrosshairTraceRequests);
+
+	FVector Start;
+	FVector End;
+
+	if (GetCrosshairTraceRay(Start, End))
+	{
+		if (!CrosshairView.bTraced)
+		{
+			INC_DWORD_STAT(STAT_CrosshairTraces);
+			GetWorld()->LineTraceSingleByChannel(CrosshairView.HitResult, Start, End, ECollisionChannel::ECC_Visibility);
+			CrosshairView.bTraced = true;
+		}
+
+		OutHitResult = CrosshairView.HitResult;
+		OutHitLocation = End;
+
+		if (OutHitResult.bBlockingHit)
+		{
+			OutHitLocation = OutHitResult.Location;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool AShooterCharacter::GetCrosshairTraceRay(FVector& OutStart, FVector& OutEnd)
+{
+	UpdateCrosshairViewCache();
+
+	if (CrosshairView.FrameNumber == GFrameCounter && CrosshairView.bDeprojected)
+	{
+		OutStart = CrosshairView.TraceStart;
+		OutEnd = CrosshairView.TraceEnd;
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_CrosshairDeprojections);
+
 	// get viewport size
 	FVector2D ViewportSize;
 	if (GEngine && GEngine->GameViewport)
@@ -1074,28 +2051,49 @@ bool AShooterCharacter::TraceUnderCrosHairs(FHitResult& OutHitResult, FVector& O
 		CrosshairWorldPosition,
 		CrosshairWorldDirection);
 
+	CrosshairView.FrameNumber = GFrameCounter;
+	CrosshairView.bDeprojected = bScreenToWorld;
+
 	if (bScreenToWorld)
 	{
 		// trace from crosshair wortld location outward
-		const FVector Start = CrosshairWorldPosition;
-		const FVector End = Start + CrosshairWorldDirection * 50000.f;
+		CrosshairView.TraceStart = CrosshairWorldPosition;
+		CrosshairView.TraceEnd = CrosshairWorldPosition + CrosshairWorldDirection * 50000.f;
+		OutStart = CrosshairView.TraceStart;
+		OutEnd = CrosshairView.TraceEnd;
+	}
 
-		OutHitLocation = End;
+	return bScreenToWorld;
+}
 
-		GetWorld()->LineTraceSingleByChannel(OutHitResult, Start, End, ECollisionChannel::ECC_Visibility);
+void AShooterCharacter::UpdateCrosshairViewCache()
+{
+	const FVector CameraLocation = FollowCamera->GetComponentLocation();
+	const FRotator CameraRotation = FollowCamera->GetComponentRotation();
 
-		if (OutHitResult.bBlockingHit)
-		{
-			OutHitLocation = OutHitResult.Location;
-			return true;
-		}
-	}
+	const bool bNewFrame = CrosshairView.FrameNumber != GFrameCounter;
+	const bool bCameraMoved = !CameraLocation.Equals(CrosshairView.CameraLocation) || !CameraRotation.Equals(CrosshairView.CameraRotation);
 
-	return false;
+	if (bNewFrame || bCameraMoved)
+	{
+		// a frame number that never matches forces a fresh deprojection
+		CrosshairView.FrameNumber = 0;
+		CrosshairView.CameraLocation = CameraLocation;
+		CrosshairView.CameraRotation = CameraRotation;
+		CrosshairView.bDeprojected = false;
+		CrosshairView.bTraced = false;
+		CrosshairView.AsyncTraceId = -1;
+	}
 }
 
 void AShooterCharacter::TraceForItems()
 {
+	// a shot queued this frame's crosshair trace before items needed it, keep last frame's item for a frame
+	if (CrosshairView.AsyncTraceId >= 0 && !CrosshairView.bTraced && CrosshairView.FrameNumber == GFrameCounter)
+	{
+		return;
+	}
+
 	if (bShouldTraceItems)
 	{
 		FHitResult ItemTraceResult;
@@ -1199,6 +2197,8 @@ void AShooterCharacter::EquipWeapon(AWeapon* WeaponToEquip, bool bSwaping)
 		// set equip weapon to newly spawned
 		EquippedWeapon = WeaponToEquip;
 		EquippedWeapon->SetItemState(EItemState::EIS_Equipped);
+		BindFireMode();
+		CacheWeaponSockets();
 	}
 }
 
@@ -1251,6 +2251,7 @@ void AShooterCharacter::InitializeAmmoMap()
 {
 	AmmoMap.Add(EAmmoType::EAT_9mm, Starting9mmAmmo);
 	AmmoMap.Add(EAmmoType::EAT_AR, StartingARAmmo);
+	AmmoMap.Add(EAmmoType::EAT_Shells, StartingShellAmmo);
 }
 
 bool AShooterCharacter::WeaponHasAmmo()
@@ -1280,6 +2281,15 @@ void AShooterCharacter::Tick(float DeltaTime)
 	// check overapped item count i onda trace for items
 	TraceForItems();
 
+	// the allocation test holds the trigger before the schedule runs
+	UpdateFiringAllocationTest();
+
+	// fire shots that came due this frame
+	UpdateFireSchedule(DeltaTime);
+
+	// apply async hitscan shots whose traces came back
+	ResolvePendingShots();
+
 	// interpolate the capsule half height
 	InterpCapsuleHalfHeight(DeltaTime);
 }
@@ -1341,6 +2351,7 @@ void AShooterCharacter::FinishReloading()
 		return;
 	}
 
+	FAllocationTracker::FScope AllocationScope;
 	const EAmmoType AmmoType = EquippedWeapon->GetAmmoType();
 	
 	// update ammo map
@@ -1357,13 +2368,13 @@ void AShooterCharacter::FinishReloading()
 			// reload the magazine with all the ammo we are carrying
 			EquippedWeapon->ReloadAmmo(CarriedAmmo);
 			CarriedAmmo = 0;
-			AmmoMap.Add(AmmoType, CarriedAmmo);
+			AmmoMap[AmmoType] = CarriedAmmo;
 		} else
 		{
 			// fill the magazine
 			EquippedWeapon->ReloadAmmo(MagEmptySpace);
 			CarriedAmmo -= MagEmptySpace;
-			AmmoMap.Add(AmmoType, CarriedAmmo);
+			AmmoMap[AmmoType] = CarriedAmmo;
 		}
 	}
 }
@@ -1382,16 +2393,6 @@ void AShooterCharacter::FinishEquipping()
 	}
 }
 
-void AShooterCharacter::ResetPickupSoundTimer()
-{
-	bShouldPlayPickupSound = true;
-}
-
-void AShooterCharacter::ResetEquipSoundTimer()
-{
-	bShouldPlayEquipSound = true;
-}
-
 float AShooterCharacter::GetCrosshairSpreadMultiplier() const
 {
 	//UE_LOG(LogTemp, Warning, TEXT("spread %f"), CrosshairSpreadMultiplier);
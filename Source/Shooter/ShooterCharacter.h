@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "AmmoType.h"
+#include "WorldCollision.h"
+#include "AudioEventSubsystem.h"
 
 #include "ShooterCharacter.generated.h"
 
@@ -33,6 +35,102 @@ struct FInterpLocation
 	
 };
 
+// one entry per pellet, single bullet weapons fire one pellet
+using FPelletEndArray = TArray<FVector, TInlineAllocator<16>>;
+
+// one hit of a shot, a penetrating pellet can hit several things along its path
+struct FShotHit
+{
+	FHitResult HitResult;
+	// power left when the pellet got here, 1 for the first thing it hits
+	float DamageScale;
+	// last hit of its pellet, the beam is drawn to it
+	bool bPelletEnd;
+};
+// room for a shotgun blast without going to the heap
+using FShotHitArray = TArray<FShotHit, TInlineAllocator<8>>;
+
+// shot waiting for its async crosshair and weapon traces
+struct FPendingShot
+{
+	uint32 ShotId;
+	TWeakObjectPtr<class AWeapon> Weapon;
+	FTransform SocketTransform;
+	float ShotTime;
+	FVector BeamEndLocation;
+	// pellet hits, filled in as the weapon traces come back
+	FShotHitArray ShotHits;
+	int32 OutstandingTraces;
+	// id of the async crosshair trace this shot waits for, shots fired on the same frame share one
+	uint32 CrosshairTraceId;
+	bool bWaitingForCrosshair;
+	bool bResolved;
+};
+
+// shot timing of one trigger pull, shots come due at the fire rate after the first one whatever the frame rate
+struct FFireSchedule
+{
+	// time left until the next shot is due, negative when shots are owed
+	float Cooldown = 0.f;
+	// frame the first shot was fired on, it already took its shot so its time doesn't count
+	uint64 StartFrame = 0;
+
+	FORCEINLINE void Start(float FireRate, uint64 FrameNumber)
+	{
+		Cooldown = FireRate;
+		StartFrame = FrameNumber;
+	}
+
+	FORCEINLINE void Advance(float DeltaTime, uint64 FrameNumber)
+	{
+		if (FrameNumber != StartFrame)
+		{
+			Cooldown -= DeltaTime;
+		}
+	}
+
+	FORCEINLINE bool IsShotDue() const { return Cooldown <= 0.f; }
+
+	// the due shot was due -Cooldown seconds before FrameTime
+	FORCEINLINE float GetDueShotTime(float FrameTime) const { return FrameTime + Cooldown; }
+
+	FORCEINLINE void ConsumeShot(float FireRate) { Cooldown += FireRate; }
+};
+
+// shooter.HitscanBenchmark - the same pellet rays traced synchronously and through the async trace queue
+struct FHitscanBenchmark
+{
+	TWeakObjectPtr<class AWeapon> Weapon;
+	FVector MuzzleLocation;
+	TArray<FVector> PelletEnds;
+	// one entry per pellet, in PelletEnds order
+	TArray<FShotHitArray> SyncHits;
+	TArray<FShotHitArray> AsyncHits;
+	int32 ShotCount;
+	int32 OutstandingTraces;
+	// game thread time
+	double SyncMs;
+	double AsyncMs;
+};
+
+// crosshair deprojection and trace, computed at most once per frame and shared by item tracing and firing
+struct FCrosshairViewCache
+{
+	uint64 FrameNumber;
+	FVector CameraLocation;
+	FRotator CameraRotation;
+
+	bool bDeprojected;
+	FVector TraceStart;
+	FVector TraceEnd;
+
+	bool bTraced;
+	FHitResult HitResult;
+
+	// async crosshair trace queued this frame, -1 if none
+	int64 AsyncTraceId;
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FEQuiItemDelegate, int32, CurrentSlotIndex, int32, NewSlotIndex);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FHighlightIconDelegate, int32, SlotIndex, bool, bStartAnimation);
 
@@ -50,6 +148,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	// kretanje naprijed/nazad
 	void MoveForward(float Value);
@@ -70,7 +169,23 @@ protected:
 
 	void FireWeapon();
 
-	bool GetBeamEndLocation(const FVector& MuzlleSocketLocation, FHitResult& OutHitResoult);
+	// crosshair hit location, or the end of the crosshair trace if nothing was hit
+	bool GetBeamLocation(FVector& OutBeamLocation);
+
+	// traces every pellet from the muzzle to its end, collects blocking hits
+	void TraceWeaponPellets(AWeapon* Weapon, const FVector& MuzzleSocketLocation, TArrayView<const FVector> PelletEnds, FShotHitArray& OutShotHits);
+
+	// penetrating pellets use one multi hit trace with everything set to overlap, the path is walked without re-tracing
+	FCollisionQueryParams GetWeaponTraceParams(const AWeapon* Weapon) const;
+	const FCollisionResponseParams& GetWeaponTraceResponse(const AWeapon* Weapon) const;
+
+	// turns the hits of one pellet trace into shot hits, spending penetration power per surface
+	void AddPelletHits(const AWeapon* Weapon, TArrayView<const FHitResult> TraceHits, FShotHitArray& OutShotHits) const;
+
+	void GetPelletTraceEnds(const AWeapon* Weapon, const FVector& MuzzleSocketLocation, const FVector& BeamLocation, FPelletEndArray& OutPelletEnds) const;
+
+	// muzzle trace goes a bit past the crosshair hit so it doesn't stop short of the target
+	FVector GetWeaponTraceEnd(const FVector& MuzzleSocketLocation, const FVector& BeamLocation) const;
 
 	void AimingButtonPressed();
 	
@@ -88,12 +203,37 @@ protected:
 	void FireButtonPressed();
 	void FireButtonReleased();
 	
-	void StartFireTimer();
-	
-	UFUNCTION()
-	void AutoFireReset();
+	// starts the fire schedule after the first shot of a trigger pull
+	void StartFireSchedule();
+
+	// automatic weapons with a loop sound - one loop voice for the whole trigger pull instead of a voice per shot
+	void StartFireLoop();
+	void StopFireLoop();
+
+	// picks the fire mode policies for the equipped weapon
+	void BindFireMode();
+
+	// barrel socket and clip bone of the equipped weapon, looked up once instead of by name every shot,
+	// also warms up the muzzle flash pool
+	void CacheWeaponSockets();
+
+	template <typename TTriggerPolicy, typename TSlideRecoilPolicy>
+	static auto SelectFireMode() { return &AShooterCharacter::FireScheduledShot<TTriggerPolicy, TSlideRecoilPolicy>; }
+
+	// one shot of the fire schedule, false when the trigger policy ends the sequence
+	template <typename TTriggerPolicy, typename TSlideRecoilPolicy>
+	bool FireScheduledShot(float ShotTime);
+
+	// fires every shot that came due this frame, ends the schedule when the trigger is released or the clip is empty
+	void UpdateFireSchedule(float DeltaTime);
 
 	bool TraceUnderCrosHairs(FHitResult& OutHitResult, FVector& OutHitLocation);
+
+	// deprojects the screen centre, false if there is no viewport to deproject from
+	bool GetCrosshairTraceRay(FVector& OutStart, FVector& OutEnd);
+
+	// drops the cached crosshair view on a new frame or when the camera moved
+	void UpdateCrosshairViewCache();
 	
 	void TraceForItems();
 
@@ -116,7 +256,27 @@ protected:
 	bool WeaponHasAmmo();
 
 	void PlayFireSound();
-	void SendBullet();
+	// ShotTime is when the shot was due, can be earlier than the current frame time
+	void FireShot(float ShotTime);
+	void SendBullet(float ShotTime);
+
+	// applies damage, impact FX and bullet hit notifications for all pellet hits of one shot
+	void ApplyShotHits(AWeapon* Weapon, const FTransform& SocketTransform, TArrayView<const FShotHit> ShotHits, float ShotTime);
+
+	// server check of a client hit - retraces it against the target's hitboxes rewound to ShotTime
+	bool ValidateShotHit(const FHitResult& HitResult, float ShotTime) const;
+
+	// ballistic weapons hand their pellets to the ballistics subsystem instead of tracing
+	void FireBallisticBullets(const FTransform& SocketTransform);
+
+	// async hitscan - crosshair trace, then muzzle trace, then ResolvePendingShots() applies the hit
+	void QueueAsyncBullet(const FTransform& SocketTransform, float ShotTime);
+	void OnCrosshairTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+	void QueueAsyncWeaponTrace(FPendingShot& Shot);
+	void QueueAsyncPelletTraces(const AWeapon* Weapon, const FVector& MuzzleSocketLocation, TArrayView<const FVector> PelletEnds, FTraceDelegate* Delegate, uint32 UserData);
+	void OnWeaponTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+	FPendingShot* FindPendingShot(uint32 ShotId);
+	void ResolvePendingShots();
 	void PlayGunfireMontage();
 
 	void ReloadButtonPressed();
@@ -156,6 +316,7 @@ protected:
 
 	void HighlightInventorySlot();
 
+	// surface under the character from the movement floor, kept for the footstep blueprints
 	UFUNCTION(BlueprintCallable)
 	EPhysicalSurface GetSurfaceType();
 
@@ -228,6 +389,17 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	UParticleSystem* BeamParticles;
 
+	// tracers are drawn as instances of this mesh by the tracer subsystem, BeamParticles are spawned when it is not set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	class UStaticMesh* TracerMesh;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	class UMaterialInterface* TracerMaterial;
+
+	// particles and decals per surface for hits on the world, ImapactParticles are spawned when it is not set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	class UImpactSurfaceDataAsset* ImpactSurfaces;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	bool bAiming;
 
@@ -263,7 +435,57 @@ private:
 	bool bFireButtonPressed;
 	bool bShouldFire;
 	//float AutomaticFireRate;
-	FTimerHandle AutoFireTimer;
+
+	FFireSchedule FireSchedule;
+
+	// bound in BindFireMode when a weapon is equipped
+	using FFireModeFunction = bool (AShooterCharacter::*)(float ShotTime);
+	FFireModeFunction FireModeFunction;
+
+	// shots fired since the trigger was pulled
+	int32 ShotsInSequence;
+
+	// pooled weapon fire voice of the loop
+	FAudioLoopHandle FireLoopHandle;
+
+	bool bFireLoopPlaying;
+
+	// cached in CacheWeaponSockets when a weapon is equipped
+	const class USkeletalMeshSocket* EquippedBarrelSocket;
+	int32 EquippedClipBoneIndex;
+
+	// shooter.FiringAllocationTest - shots fired so far, rounds to count (0 when not running) and frames since the trigger was let go
+	int32 AllocationTestShots;
+	int32 AllocationTestRounds;
+	int32 AllocationTestSettleFrame;
+
+	// holds the trigger while the allocation test runs, logs the result at the end
+	void UpdateFiringAllocationTest();
+
+	// shots fired in async hitscan mode, waiting for their traces
+	TArray<FPendingShot> PendingShots;
+
+	// hitbox poses recorded on the server for rewinding shots
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	class UHitboxHistoryComponent* HitboxHistory;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Audio, meta = (AllowPrivateAccess = "true"))
+	class UFootstepComponent* Footsteps;
+
+	// reused by the penetrating multi hit traces
+	TArray<FHitResult> PenetrationTraceHits;
+	uint32 NextShotId;
+
+	FTraceDelegate CrosshairTraceDelegate;
+	FTraceDelegate WeaponTraceDelegate;
+
+	FHitscanBenchmark HitscanBenchmark;
+	FTraceDelegate HitscanBenchmarkTraceDelegate;
+
+	void OnHitscanBenchmarkTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+	void FinishHitscanBenchmark();
+
+	FCrosshairViewCache CrosshairView;
 
 	bool bShouldTraceItems;
 	int8 OverlappedItemCount;
@@ -295,6 +517,9 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Items, meta = (AllowPrivateAccess = "true"))
 	int32 StartingARAmmo;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Items, meta = (AllowPrivateAccess = "true"))
+	int32 StartingShellAmmo;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	ECombatState CombatState;
 
@@ -366,16 +591,7 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	TArray<FInterpLocation> InterpLocations;
 
-	FTimerHandle PickupSoundTimer;
-	FTimerHandle EquipSoundTimer;
-
-	bool bShouldPlayPickupSound;
-	bool bShouldPlayEquipSound;
-
-	
-	void ResetPickupSoundTimer();
-	void ResetEquipSoundTimer();
-
+	// least time between two pickup / equip sounds, handed to the audio event subsystem rate limiter
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Items, meta = (AllowPrivateAccess = "true"))
 	float PickupSoundResetTime;
 
@@ -452,12 +668,6 @@ public:
 
 	void IncrementInterpLocItemCount(int32 Index, int32 Amount);
 
-	FORCEINLINE bool ShouldPlayPickupSound() const { return  bShouldPlayEquipSound; }
-	FORCEINLINE bool ShouldPlayEquipSound() const { return bShouldPlayEquipSound; }
-
-	void StartPickupSoundTimer();
-	void StartEquipSoundTimer();
-
 	void UnHighlightInventorySlot();
 
 	FORCEINLINE	AWeapon* GetEquippedWeapon() const { return  EquippedWeapon; }
@@ -470,4 +680,19 @@ public:
 
 	FORCEINLINE float GetStunChance() const { return  StunChance; }
 
+	FORCEINLINE bool IsDead() const { return bDead; }
+
+	// called by the ballistics subsystem when one of our bullets hits something
+	void ApplyBallisticHit(AWeapon* Weapon, const FVector& MuzzleLocation, const FHitResult& HitResult, float TraceTime);
+
+	// holds the trigger until Rounds shots were fired after a warm up and checks the firing path did not allocate
+	void StartFiringAllocationTest(int32 Rounds);
+
+	// shoots a crowd of EnemyCount spawned enemies with Shots shots of Pellets pellets and logs the cost per shot
+	void RunShotgunBenchmark(int32 EnemyCount, int32 Shots, int32 Pellets);
+
+	// traces Shots shots of the equipped weapon synchronously and async, logs the game thread cost of both once
+	// the async traces are back and whether both found the same hits
+	void StartHitscanBenchmark(int32 Shots);
+
 };
@@ -0,0 +1,194 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TracerSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Tracer Update"), STAT_TracerUpdate, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tracers"), STAT_Tracers, STATGROUP_Shooter);
+
+static FAutoConsoleCommand TracerBenchmarkCommand(
+	TEXT("shooter.TracerBenchmark"),
+	TEXT("Updates tracers without a world and logs the cost of one update.\n")
+	TEXT("shooter.TracerBenchmark [TracerCount=500] [StepCount=1000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 TracerCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 500;
+		const int32 StepCount = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1000;
+		UTracerSubsystem::RunBenchmark(TracerCount, StepCount);
+	}));
+
+void FTracerList::RemoveFinished(float Time)
+{
+	// going backwards, the tracer swapped in from the end was already checked
+	for (int32 Index = Tracers.Num() - 1; Index >= 0; --Index)
+	{
+		const FTracer& Tracer = Tracers[Index];
+		const float Tail = Speed * (Time - Tracer.SpawnTime) - StreakLength;
+		if (Tail >= FVector::Dist(Tracer.Start, Tracer.End))
+		{
+			Tracers.RemoveAtSwap(Index, 1, false);
+		}
+	}
+}
+
+void FTracerList::BuildTransforms(float Time, TArray<FTransform>& OutTransforms) const
+{
+	OutTransforms.Reset(Tracers.Num());
+
+	for (const FTracer& Tracer : Tracers)
+	{
+		const FVector Delta = Tracer.End - Tracer.Start;
+		const float Distance = Delta.Size();
+		const FVector Direction = Distance > KINDA_SMALL_NUMBER ? Delta / Distance : FVector::ForwardVector;
+
+		// streak head moves at Speed and stops at the end, the tail follows StreakLength behind
+		const float Head = FMath::Min(Speed * (Time - Tracer.SpawnTime), Distance);
+		const float Tail = FMath::Max(Head - StreakLength, 0.f);
+
+		OutTransforms.Add(FTransform(
+			Direction.ToOrientationQuat(),
+			Tracer.Start + Direction * ((Head + Tail) * 0.5f),
+			FVector((Head - Tail) / MeshLength, 1.f, 1.f)));
+	}
+}
+
+void FTracerList::AddStreakTransform(const FVector& Tail, const FVector& Head, TArray<FTransform>& OutTransforms) const
+{
+	const FVector Delta = Head - Tail;
+	const float Distance = Delta.Size();
+	const FVector Direction = Distance > KINDA_SMALL_NUMBER ? Delta / Distance : FVector::ForwardVector;
+	const float Length = FMath::Min(Distance, StreakLength);
+
+	OutTransforms.Add(FTransform(
+		Direction.ToOrientationQuat(),
+		Head - Direction * (Length * 0.5f),
+		FVector(Length / MeshLength, 1.f, 1.f)));
+}
+
+void UTracerSubsystem::Deinitialize()
+{
+	if (InstanceComponent)
+	{
+		InstanceComponent->DestroyComponent();
+		InstanceComponent = nullptr;
+	}
+
+	TracerList.Tracers.Reset();
+	FrameStreaks.Reset();
+	VisibleInstances = 0;
+
+	Super::Deinitialize();
+}
+
+void UTracerSubsystem::SetTracerMesh(UStaticMesh* Mesh, UMaterialInterface* Material)
+{
+	if (Mesh == nullptr)
+	{
+		return;
+	}
+
+	if (InstanceComponent == nullptr)
+	{
+		UWorld* World = GetWorld();
+		InstanceComponent = NewObject<UInstancedStaticMeshComponent>(World);
+		InstanceComponent->SetMobility(EComponentMobility::Movable);
+		InstanceComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		InstanceComponent->SetCastShadow(false);
+		InstanceComponent->RegisterComponentWithWorld(World);
+	}
+
+	InstanceComponent->SetStaticMesh(Mesh);
+	if (Material)
+	{
+		InstanceComponent->SetMaterial(0, Material);
+	}
+}
+
+void UTracerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TracerUpdate);
+
+	const float Time = GetWorld()->GetTimeSeconds();
+	TracerList.RemoveFinished(Time);
+
+	SET_DWORD_STAT(STAT_Tracers, TracerList.Num());
+
+	if (InstanceComponent == nullptr)
+	{
+		// nothing to draw them with
+		TracerList.Tracers.Reset();
+		FrameStreaks.Reset();
+		return;
+	}
+
+	TracerList.BuildTransforms(Time, InstanceTransforms);
+	for (const FTracer& Streak : FrameStreaks)
+	{
+		TracerList.AddStreakTransform(Streak.Start, Streak.End, InstanceTransforms);
+	}
+	FrameStreaks.Reset();
+	const int32 LiveInstances = InstanceTransforms.Num();
+
+	// hide the instances of tracers that finished since last frame
+	for (int32 Index = LiveInstances; Index < VisibleInstances; ++Index)
+	{
+		InstanceTransforms.Add(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector));
+	}
+
+	// component sits at the origin, instance space is world space
+	while (InstanceComponent->GetInstanceCount() < InstanceTransforms.Num())
+	{
+		InstanceComponent->AddInstance(FTransform::Identity);
+	}
+
+	if (InstanceTransforms.Num() > 0)
+	{
+		InstanceComponent->BatchUpdateInstancesTransforms(0, InstanceTransforms, true, true, false);
+	}
+
+	VisibleInstances = LiveInstances;
+}
+
+ETickableTickType UTracerSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UTracerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTracerSubsystem, STATGROUP_Tickables);
+}
+
+void UTracerSubsystem::RunBenchmark(int32 TracerCount, int32 StepCount)
+{
+	TracerCount = FMath::Max(TracerCount, 1);
+	StepCount = FMath::Max(StepCount, 1);
+
+	FTracerList BenchmarkList;
+	// tracers never finish during the benchmark
+	BenchmarkList.Speed = 0.f;
+	BenchmarkList.Tracers.Reserve(TracerCount);
+
+	FRandomStream RandomStream(TracerCount);
+	for (int32 Index = 0; Index < TracerCount; ++Index)
+	{
+		const FVector Start = RandomStream.GetUnitVector() * 1000.f;
+		BenchmarkList.Add(Start, Start + RandomStream.GetUnitVector() * 5000.f, 0.f);
+	}
+
+	TArray<FTransform> Transforms;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Step = 0; Step < StepCount; ++Step)
+	{
+		BenchmarkList.RemoveFinished(Step / 60.f);
+		BenchmarkList.BuildTransforms(Step / 60.f, Transforms);
+	}
+	const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogTemp, Log, TEXT("Tracer benchmark: %d tracers, %d updates, %.3f us per update"),
+		TracerCount, StepCount, ElapsedSeconds * 1.0e6 / StepCount);
+}
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "TracerSubsystem.generated.h"
+
+class UStaticMesh;
+class UMaterialInterface;
+class UInstancedStaticMeshComponent;
+
+struct FTracer
+{
+	FVector Start;
+	FVector End;
+	float SpawnTime;
+};
+
+/**
+ * Live tracers in one flat array, each one a streak moving from Start to End.
+ * Plain struct so it can be updated without a world (benchmark).
+ */
+struct FTracerList
+{
+	TArray<FTracer> Tracers;
+
+	float Speed = 50000.f;
+	float StreakLength = 600.f;
+	// length along X of the tracer mesh at scale 1
+	float MeshLength = 100.f;
+
+	FORCEINLINE int32 Num() const { return Tracers.Num(); }
+	FORCEINLINE void Add(const FVector& Start, const FVector& End, float SpawnTime) { Tracers.Add(FTracer{ Start, End, SpawnTime }); }
+
+	// removes tracers whose streak reached the end, order is not kept
+	void RemoveFinished(float Time);
+
+	// one instance transform per tracer
+	void BuildTransforms(float Time, TArray<FTransform>& OutTransforms) const;
+
+	// the last StreakLength units of the segment
+	void AddStreakTransform(const FVector& Tail, const FVector& Head, TArray<FTransform>& OutTransforms) const;
+};
+
+/**
+ * Draws every tracer in the world as an instance of one instanced static mesh,
+ * instead of spawning a beam emitter per shot. Adding a tracer is one array append,
+ * instance transforms are rebuilt once per frame.
+ */
+UCLASS()
+class SHOOTER_API UTracerSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// the mesh should be a streak along X, TracerList.MeshLength units long
+	void SetTracerMesh(UStaticMesh* Mesh, UMaterialInterface* Material);
+	FORCEINLINE bool HasTracerMesh() const { return InstanceComponent != nullptr; }
+
+	FORCEINLINE void AddTracer(const FVector& Start, const FVector& End) { TracerList.Add(Start, End, GetWorld()->GetTimeSeconds()); }
+
+	// drawn for one frame only, for bullets that are moved by the ballistics subsystem
+	FORCEINLINE void AddFrameStreak(const FVector& Tail, const FVector& Head) { FrameStreaks.Add(FTracer{ Tail, Head, 0.f }); }
+
+	FORCEINLINE int32 GetTracerCount() const { return TracerList.Num(); }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return TracerList.Num() > 0 || FrameStreaks.Num() > 0 || VisibleInstances > 0; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+	// updates TracerCount tracers StepCount times without a world and logs us per update
+	static void RunBenchmark(int32 TracerCount, int32 StepCount);
+
+private:
+	FTracerList TracerList;
+
+	// cleared every frame once drawn
+	TArray<FTracer> FrameStreaks;
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* InstanceComponent = nullptr;
+
+	// reused every frame
+	TArray<FTransform> InstanceTransforms;
+
+	// instances are never removed, the ones past the live tracers are scaled to zero
+	int32 VisibleInstances = 0;
+};
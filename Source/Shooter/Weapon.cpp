@@ -12,12 +12,20 @@ AWeapon::AWeapon() :
 	MagazieCapacity(30),
 	ReloadMontageSection(FName(TEXT("Reload SMG"))),
 	ClipBoneName(TEXT("smg_clip")),
+	FireLoopShotInterval(0.f),
 	SlideDisplacement(0.f),
 	SlideDisplacementTime(0.2f),
 	bMovingSlide(false),
 	MaxSlideDisplacement(4.f),
 	MaxRecoilRotation(20.f),
-	bAutomatic(true)
+	bAutomatic(true),
+	BurstCount(0),
+	PelletCount(1),
+	PelletSpread(0.f),
+	bPenetrating(false),
+	PenetrationPower(0.f),
+	bBallistic(false),
+	MuzzleVelocity(30000.f)
 {
 	PrimaryActorTick.bCanEverTick = true;
 }
@@ -99,24 +107,7 @@ void AWeapon::OnConstruction(const FTransform& Transform)
 {
 	Super::OnConstruction(Transform);
 	
-	const FString WeaponTablePath(TEXT("DataTable'/Game/_Game/DataTable/WeaponDatatable.WeaponDatatable'"));
-	UDataTable* WeaponTableObject = Cast<UDataTable>(StaticLoadObject(UDataTable::StaticClass(), nullptr, *WeaponTablePath));
-
-	FWeaponDataTable* WeaponDataRow = nullptr;
-	
-	switch (WeaponType) {
-	case EWeaponType::EWT_SubmachineGun:
-		WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("SubmachineGun"), TEXT(""));
-		break;
-	case EWeaponType::EWT_AssaultRifle:
-		WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("AssoultRifle"), TEXT(""));
-		break;
-	case EWeaponType::EWT_Pistol:
-		WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("Pistol"), TEXT(""));
-		break;
-
-	default: ;
-	}
+	FWeaponDataTable* WeaponDataRow = FindWeaponDataRow();
 
 	if (WeaponDataRow)
 	{
@@ -145,13 +136,26 @@ void AWeapon::OnConstruction(const FTransform& Transform)
 		AutoFireRate = WeaponDataRow->AutoFireRate;
 		MuzzleFlash = WeaponDataRow->MuzzleFlash;
 		FireSound = WeaponDataRow->FireSound;
+		FireLoopSound = WeaponDataRow->FireLoopSound;
+		FireTailSound = WeaponDataRow->FireTailSound;
+		FireLoopShotInterval = WeaponDataRow->FireLoopShotInterval;
 		BoneToHide = WeaponDataRow->BoneToHide;
 		bAutomatic = WeaponDataRow->bAutomatic;
+		BurstCount = WeaponDataRow->BurstCount;
 		Damage = WeaponDataRow->Damage;
 		HeadShotDamage = WeaponDataRow->HeadShotDamage;
+		PelletCount = WeaponDataRow->PelletCount;
+		PelletSpread = WeaponDataRow->PelletSpread;
+		bPenetrating = WeaponDataRow->bPenetrating;
+		PenetrationPower = WeaponDataRow->PenetrationPower;
+		bBallistic = WeaponDataRow->bBallistic;
+		MuzzleVelocity = WeaponDataRow->MuzzleVelocity;
 
 	}
 
+	BuildZoneDamage(WeaponDataRow);
+	BuildPenetrationCost(WeaponDataRow);
+
 	if (GetMaterialInstance())
 	{
 		SetDynamicMaterialInstance(UMaterialInstanceDynamic::Create(GetMaterialInstance(), this));
@@ -161,6 +165,78 @@ void AWeapon::OnConstruction(const FTransform& Transform)
 	}
 }
 
+void AWeapon::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	const FWeaponDataTable* WeaponDataRow = FindWeaponDataRow();
+	BuildZoneDamage(WeaponDataRow);
+	BuildPenetrationCost(WeaponDataRow);
+}
+
+FWeaponDataTable* AWeapon::FindWeaponDataRow() const
+{
+	const FString WeaponTablePath(TEXT("DataTable'/Game/_Game/DataTable/WeaponDatatable.WeaponDatatable'"));
+	UDataTable* WeaponTableObject = Cast<UDataTable>(StaticLoadObject(UDataTable::StaticClass(), nullptr, *WeaponTablePath));
+	if (WeaponTableObject == nullptr)
+	{
+		return nullptr;
+	}
+
+	switch (WeaponType) {
+	case EWeaponType::EWT_SubmachineGun:
+		return WeaponTableObject->FindRow<FWeaponDataTable>(FName("SubmachineGun"), TEXT(""));
+	case EWeaponType::EWT_AssaultRifle:
+		return WeaponTableObject->FindRow<FWeaponDataTable>(FName("AssoultRifle"), TEXT(""));
+	case EWeaponType::EWT_Pistol:
+		return WeaponTableObject->FindRow<FWeaponDataTable>(FName("Pistol"), TEXT(""));
+	case EWeaponType::EWT_Shotgun:
+		return WeaponTableObject->FindRow<FWeaponDataTable>(FName("Shotgun"), TEXT(""));
+
+	default:
+		return nullptr;
+	}
+}
+
+void AWeapon::BuildZoneDamage(const FWeaponDataTable* WeaponDataRow)
+{
+	// per zone damage - head and body come from the headshot / body damage, the row can override any zone
+	for (float& ZoneDamageValue : ZoneDamage)
+	{
+		ZoneDamageValue = Damage;
+	}
+	ZoneDamage[static_cast<int32>(EHitZone::EHZ_Head)] = HeadShotDamage;
+
+	if (WeaponDataRow)
+	{
+		for (const TPair<EHitZone, float>& ZoneDamagePair : WeaponDataRow->ZoneDamage)
+		{
+			if (ZoneDamagePair.Key < EHitZone::EHZ_MAX)
+			{
+				ZoneDamage[static_cast<int32>(ZoneDamagePair.Key)] = ZoneDamagePair.Value;
+			}
+		}
+	}
+}
+
+void AWeapon::BuildPenetrationCost(const FWeaponDataTable* WeaponDataRow)
+{
+	// flatten the surface table so a penetrating trace only does an array lookup per hit
+	const float DefaultPenetrationCost = WeaponDataRow ? WeaponDataRow->DefaultPenetrationCost : 100.f;
+	for (float& PenetrationCostValue : PenetrationCost)
+	{
+		PenetrationCostValue = DefaultPenetrationCost;
+	}
+
+	if (WeaponDataRow)
+	{
+		for (const TPair<TEnumAsByte<EPhysicalSurface>, float>& PenetrationCostPair : WeaponDataRow->PenetrationCost)
+		{
+			PenetrationCost[PenetrationCostPair.Key] = PenetrationCostPair.Value;
+		}
+	}
+}
+
 void AWeapon::BeginPlay()
 {
 	Super::BeginPlay();
@@ -6,6 +6,7 @@
 #include "Item.h"
 #include  "AmmoType.h"
 #include "WeaponType.h"
+#include "HitZone.h"
 #include "Weapon.generated.h"
 
 
@@ -83,6 +84,18 @@ struct FWeaponDataTable : public FTableRowBase
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	USoundCue* FireSound;
 
+	// automatic weapons - loop with one shot every FireLoopShotInterval seconds, played while the trigger is held
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	USoundCue* FireLoopSound;
+
+	// played when the loop stops
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	USoundCue* FireTailSound;
+
+	// seconds between shots in the loop sound, the loop is pitched to AutoFireRate, 0 = already at AutoFireRate
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float FireLoopShotInterval = 0.f;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FName BoneToHide;
 
@@ -95,6 +108,44 @@ struct FWeaponDataTable : public FTableRowBase
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float HeadShotDamage;
 
+	// overrides damage for single zones, zones not listed use Damage (HeadShotDamage for the head)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TMap<EHitZone, float> ZoneDamage;
+
+	// pellets per shot, 1 for everything except shotguns
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 PelletCount = 1;
+
+	// half angle of the pellet cone in degrees
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float PelletSpread = 0.f;
+
+	// high calibre weapons - the bullet goes through everything along its path until it runs out of power
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bPenetrating = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float PenetrationPower = 0.f;
+
+	// power lost going through one object of the surface, surfaces not listed use DefaultPenetrationCost
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TMap<TEnumAsByte<EPhysicalSurface>, float> PenetrationCost;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float DefaultPenetrationCost = 100.f;
+
+	// shots per trigger pull for burst weapons, 0 or 1 for semi / automatic
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 BurstCount = 0;
+
+	// bullets fly with muzzle velocity and drop instead of hitting instantly
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bBallistic = false;
+
+	// cm/s
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MuzzleVelocity = 30000.f;
+
 };
 
 /**
@@ -115,8 +166,17 @@ protected:
 
 	virtual void OnConstruction(const FTransform& Transform) override;
 
+	// the lookup tables aren't saved with the actor, placed and cooked weapons don't get OnConstruction
+	virtual void PostInitializeComponents() override;
+
 	virtual void BeginPlay() override;
 
+	// row of the weapon type in the weapon data table, null when it has none
+	FWeaponDataTable* FindWeaponDataRow() const;
+
+	void BuildZoneDamage(const FWeaponDataTable* WeaponDataRow);
+	void BuildPenetrationCost(const FWeaponDataTable* WeaponDataRow);
+
 	void FinishMovingSlide();
 	void UpdateSlideDisplacement();
 	
@@ -179,6 +239,15 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
 	USoundCue* FireSound;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
+	USoundCue* FireLoopSound;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
+	USoundCue* FireTailSound;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
+	float FireLoopShotInterval;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
 	FName BoneToHide;
 
@@ -208,11 +277,38 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
 	bool bAutomatic;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	int32 BurstCount;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
 	float Damage;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
 	float HeadShotDamage;
+
+	// damage per hit zone, indexed by EHitZone
+	float ZoneDamage[static_cast<int32>(EHitZone::EHZ_MAX)];
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	int32 PelletCount;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	float PelletSpread;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	bool bPenetrating;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	float PenetrationPower;
+
+	// penetration cost per surface, indexed by EPhysicalSurface
+	float PenetrationCost[SurfaceType_Max];
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	bool bBallistic;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properties", meta = (AllowPrivateAccess = "true"))
+	float MuzzleVelocity;
 	
 		
 public:
@@ -242,12 +338,31 @@ public:
 	FORCEINLINE float GetAutoFireRate() const { return  AutoFireRate; }
 	FORCEINLINE UParticleSystem* GetMuzzleFlash() const { return MuzzleFlash; }
 	FORCEINLINE USoundCue* GetFireSound() const { return  FireSound; }
+	FORCEINLINE USoundCue* GetFireLoopSound() const { return FireLoopSound; }
+	FORCEINLINE USoundCue* GetFireTailSound() const { return FireTailSound; }
+	FORCEINLINE float GetFireLoopShotInterval() const { return FireLoopShotInterval; }
+	// burst weapons keep a sound per shot
+	FORCEINLINE bool HasFireLoop() const { return bAutomatic && !IsBurst() && FireLoopSound != nullptr; }
 
 	FORCEINLINE bool GetAutomatic() const { return  bAutomatic; }
+	FORCEINLINE int32 GetBurstCount() const { return BurstCount; }
+	FORCEINLINE bool IsBurst() const { return BurstCount > 1; }
 
 	FORCEINLINE float GetDamage() const { return Damage; }
 	FORCEINLINE float GetHeadShotDamage() const { return  HeadShotDamage; }
 
+	FORCEINLINE float GetZoneDamage(EHitZone Zone) const { return ZoneDamage[static_cast<int32>(Zone)]; }
+
+	FORCEINLINE int32 GetPelletCount() const { return PelletCount; }
+	FORCEINLINE float GetPelletSpread() const { return PelletSpread; }
+
+	FORCEINLINE bool IsPenetrating() const { return bPenetrating && PenetrationPower > 0.f; }
+	FORCEINLINE float GetPenetrationPower() const { return PenetrationPower; }
+	FORCEINLINE float GetPenetrationCost(EPhysicalSurface Surface) const { return PenetrationCost[Surface]; }
+
+	FORCEINLINE bool IsBallistic() const { return bBallistic && MuzzleVelocity > 0.f; }
+	FORCEINLINE float GetMuzzleVelocity() const { return MuzzleVelocity; }
+
 	bool ClipIsFull();
 
 };
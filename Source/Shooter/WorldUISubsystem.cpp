@@ -0,0 +1,336 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WorldUISubsystem.h"
+#include "HitNumberWidget.h"
+#include "HealthBarWidget.h"
+#include "Blueprint/UserWidget.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+#include "SceneView.h"
+#include "Shooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("World UI update"), STAT_WorldUIUpdate, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("World UI markers"), STAT_WorldUIMarkers, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("World UI widgets created"), STAT_WorldUIWidgetsCreated, STATGROUP_Shooter);
+
+static TAutoConsoleVariable<int32> CVarWorldUIMaxMarkers(
+	TEXT("shooter.WorldUIMaxMarkers"),
+	64,
+	TEXT("Most hit numbers and health bars on screen, the one closest to expiring is recycled past it."),
+	ECVF_Default);
+
+void UWorldUISubsystem::Deinitialize()
+{
+	for (UUserWidget* Widget : MarkerWidgets)
+	{
+		if (Widget)
+		{
+			Widget->RemoveFromParent();
+		}
+	}
+
+	for (FWorldWidgetPool& Pool : Pools)
+	{
+		for (UUserWidget* Widget : Pool.Free)
+		{
+			if (Widget)
+			{
+				Widget->RemoveFromParent();
+			}
+		}
+	}
+
+	Pools.Reset();
+	MarkerWidgets.Reset();
+	MarkerLocations.Reset();
+	MarkerAnchors.Reset();
+	MarkerExpireTimes.Reset();
+	MarkerPools.Reset();
+	MarkerOnScreen.Reset();
+
+	Super::Deinitialize();
+}
+
+int32 UWorldUISubsystem::FindOrAddPool(UClass* WidgetClass)
+{
+	const int32 PoolIndex = Pools.IndexOfByPredicate([WidgetClass](const FWorldWidgetPool& Pool) { return Pool.WidgetClass == WidgetClass; });
+	if (PoolIndex != INDEX_NONE)
+	{
+		return PoolIndex;
+	}
+
+	FWorldWidgetPool NewPool;
+	NewPool.WidgetClass = WidgetClass;
+	return Pools.Add(NewPool);
+}
+
+UUserWidget* UWorldUISubsystem::CreatePooledWidget(UClass* WidgetClass)
+{
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController == nullptr || !PlayerController->IsLocalController())
+	{
+		return nullptr;
+	}
+
+	UUserWidget* Widget = CreateWidget<UUserWidget>(PlayerController, WidgetClass);
+	if (Widget)
+	{
+		// stays in the viewport for good, free widgets are only collapsed
+		Widget->AddToViewport();
+		Widget->SetVisibility(ESlateVisibility::Collapsed);
+		INC_DWORD_STAT(STAT_WorldUIWidgetsCreated);
+	}
+	return Widget;
+}
+
+UUserWidget* UWorldUISubsystem::AcquireWidget(UClass* WidgetClass, int32& OutPoolIndex)
+{
+	OutPoolIndex = FindOrAddPool(WidgetClass);
+	FWorldWidgetPool& Pool = Pools[OutPoolIndex];
+
+	while (Pool.Free.Num() > 0)
+	{
+		UUserWidget* Widget = Pool.Free.Pop(false);
+		if (Widget)
+		{
+			return Widget;
+		}
+	}
+
+	return CreatePooledWidget(WidgetClass);
+}
+
+void UWorldUISubsystem::Prewarm(TSubclassOf<UUserWidget> WidgetClass, int32 Count)
+{
+	if (WidgetClass == nullptr)
+	{
+		return;
+	}
+
+	const int32 PoolIndex = FindOrAddPool(WidgetClass);
+	while (Pools[PoolIndex].Free.Num() < Count)
+	{
+		UUserWidget* Widget = CreatePooledWidget(WidgetClass);
+		if (Widget == nullptr)
+		{
+			return;
+		}
+		Pools[PoolIndex].Free.Add(Widget);
+	}
+}
+
+int32 UWorldUISubsystem::AddMarker(UUserWidget* Widget, int32 PoolIndex, AActor* Anchor, const FVector& Location, float Lifetime)
+{
+	// at least one marker, so there is always one to recycle
+	const int32 MaxMarkers = FMath::Max(CVarWorldUIMaxMarkers.GetValueOnGameThread(), 1);
+	if (MarkerWidgets.Num() >= MaxMarkers)
+	{
+		int32 SoonestIndex = 0;
+		for (int32 Index = 1; Index < MarkerExpireTimes.Num(); ++Index)
+		{
+			if (MarkerExpireTimes[Index] < MarkerExpireTimes[SoonestIndex])
+			{
+				SoonestIndex = Index;
+			}
+		}
+		RemoveMarker(SoonestIndex);
+	}
+
+	// hidden until the next projection pass places it
+	Widget->SetVisibility(ESlateVisibility::Hidden);
+
+	MarkerLocations.Add(Location);
+	MarkerAnchors.Add(Anchor);
+	MarkerExpireTimes.Add(GetWorld()->GetTimeSeconds() + Lifetime);
+	MarkerPools.Add(PoolIndex);
+	MarkerOnScreen.Add(false);
+	return MarkerWidgets.Add(Widget);
+}
+
+void UWorldUISubsystem::RemoveMarker(int32 Index)
+{
+	UUserWidget* Widget = MarkerWidgets[Index];
+	if (Widget)
+	{
+		if (MarkerPools[Index] != INDEX_NONE)
+		{
+			Widget->SetVisibility(ESlateVisibility::Collapsed);
+			Pools[MarkerPools[Index]].Free.Add(Widget);
+		}
+		else
+		{
+			Widget->RemoveFromParent();
+		}
+	}
+
+	MarkerWidgets.RemoveAtSwap(Index, 1, false);
+	MarkerLocations.RemoveAtSwap(Index, 1, false);
+	MarkerAnchors.RemoveAtSwap(Index, 1, false);
+	MarkerExpireTimes.RemoveAtSwap(Index, 1, false);
+	MarkerPools.RemoveAtSwap(Index, 1, false);
+	MarkerOnScreen.RemoveAtSwap(Index, 1, false);
+}
+
+void UWorldUISubsystem::ShowHitNumber(TSubclassOf<UHitNumberWidget> WidgetClass, int32 Damage, const FVector& Location, bool bHeadShot, float Lifetime)
+{
+	if (WidgetClass == nullptr)
+	{
+		return;
+	}
+
+	int32 PoolIndex;
+	UHitNumberWidget* Widget = Cast<UHitNumberWidget>(AcquireWidget(WidgetClass, PoolIndex));
+	if (Widget)
+	{
+		AddMarker(Widget, PoolIndex, nullptr, Location, Lifetime);
+		Widget->ShowHitNumber(Damage, bHeadShot);
+	}
+}
+
+void UWorldUISubsystem::ShowHealthBar(TSubclassOf<UHealthBarWidget> WidgetClass, AActor* Anchor, const FVector& Offset, float HealthPercent, float Lifetime)
+{
+	if (WidgetClass == nullptr || Anchor == nullptr)
+	{
+		return;
+	}
+
+	int32 Index = MarkerAnchors.IndexOfByKey(Anchor);
+	if (Index != INDEX_NONE)
+	{
+		MarkerLocations[Index] = Offset;
+		MarkerExpireTimes[Index] = GetWorld()->GetTimeSeconds() + Lifetime;
+	}
+	else
+	{
+		int32 PoolIndex;
+		UUserWidget* Widget = AcquireWidget(WidgetClass, PoolIndex);
+		if (Widget == nullptr)
+		{
+			return;
+		}
+		Index = AddMarker(Widget, PoolIndex, Anchor, Offset, Lifetime);
+	}
+
+	UHealthBarWidget* HealthBar = Cast<UHealthBarWidget>(MarkerWidgets[Index]);
+	if (HealthBar)
+	{
+		HealthBar->SetHealthPercent(HealthPercent);
+	}
+}
+
+void UWorldUISubsystem::HideHealthBar(AActor* Anchor)
+{
+	const int32 Index = MarkerAnchors.IndexOfByKey(Anchor);
+	if (Index != INDEX_NONE)
+	{
+		RemoveMarker(Index);
+	}
+}
+
+void UWorldUISubsystem::AddWidgetMarker(UUserWidget* Widget, const FVector& Location, float Lifetime)
+{
+	if (Widget)
+	{
+		AddMarker(Widget, INDEX_NONE, nullptr, Location, Lifetime);
+	}
+}
+
+bool UWorldUISubsystem::ProjectMarkers()
+{
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	ULocalPlayer* LocalPlayer = PlayerController ? PlayerController->GetLocalPlayer() : nullptr;
+	if (LocalPlayer == nullptr || LocalPlayer->ViewportClient == nullptr)
+	{
+		return false;
+	}
+
+	// the same view UGameplayStatics::ProjectWorldToScreen builds on every call, built once here
+	FSceneViewProjectionData ProjectionData;
+	if (!LocalPlayer->GetProjectionData(LocalPlayer->ViewportClient->Viewport, eSSP_FULL, ProjectionData))
+	{
+		return false;
+	}
+
+	const FMatrix ViewProjection = ProjectionData.ComputeViewProjectionMatrix();
+	const FIntRect ViewRect = ProjectionData.GetConstrainedViewRect();
+	const FVector2D ViewMin(ViewRect.Min.X, ViewRect.Min.Y);
+	const FVector2D ViewSize(ViewRect.Width(), ViewRect.Height());
+
+	ScreenPositions.SetNumUninitialized(WorldPositions.Num(), false);
+	for (int32 Index = 0; Index < WorldPositions.Num(); ++Index)
+	{
+		const VectorRegister ClipPosition = VectorTransformVector(VectorLoadFloat3_W1(&WorldPositions[Index]), &ViewProjection);
+		FVector4 Clip;
+		VectorStore(ClipPosition, &Clip);
+
+		// behind the camera, negative marks it off screen
+		if (Clip.W <= 0.f)
+		{
+			ScreenPositions[Index] = FVector2D(-1.f, -1.f);
+			continue;
+		}
+
+		const float InvW = 1.f / Clip.W;
+		ScreenPositions[Index] = ViewMin + FVector2D(0.5f + Clip.X * InvW * 0.5f, 0.5f - Clip.Y * InvW * 0.5f) * ViewSize;
+	}
+
+	return true;
+}
+
+void UWorldUISubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WorldUIUpdate);
+
+	const float Time = GetWorld()->GetTimeSeconds();
+
+	// going backwards, the marker swapped in from the end was already checked
+	for (int32 Index = MarkerWidgets.Num() - 1; Index >= 0; --Index)
+	{
+		const bool bAnchorGone = !MarkerAnchors[Index].IsExplicitlyNull() && !MarkerAnchors[Index].IsValid();
+		if (Time >= MarkerExpireTimes[Index] || MarkerWidgets[Index] == nullptr || bAnchorGone)
+		{
+			RemoveMarker(Index);
+		}
+	}
+
+	WorldPositions.Reset(MarkerWidgets.Num());
+	for (int32 Index = 0; Index < MarkerWidgets.Num(); ++Index)
+	{
+		const AActor* Anchor = MarkerAnchors[Index].Get();
+		WorldPositions.Add(Anchor ? Anchor->GetActorLocation() + MarkerLocations[Index] : MarkerLocations[Index]);
+	}
+
+	if (!ProjectMarkers())
+	{
+		return;
+	}
+
+	for (int32 Index = 0; Index < MarkerWidgets.Num(); ++Index)
+	{
+		const bool bOnScreen = ScreenPositions[Index].X >= 0.f;
+		if (bOnScreen)
+		{
+			MarkerWidgets[Index]->SetPositionInViewport(ScreenPositions[Index]);
+		}
+
+		if (bOnScreen != MarkerOnScreen[Index])
+		{
+			MarkerOnScreen[Index] = bOnScreen;
+			MarkerWidgets[Index]->SetVisibility(bOnScreen ? ESlateVisibility::HitTestInvisible : ESlateVisibility::Hidden);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_WorldUIMarkers, MarkerWidgets.Num());
+}
+
+ETickableTickType UWorldUISubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UWorldUISubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWorldUISubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "WorldUISubsystem.generated.h"
+
+class UUserWidget;
+class UHitNumberWidget;
+class UHealthBarWidget;
+
+// widgets of one class, free ones stay in the viewport collapsed
+USTRUCT()
+struct FWorldWidgetPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UClass* WidgetClass = nullptr;
+
+	UPROPERTY()
+	TArray<UUserWidget*> Free;
+};
+
+/**
+ * Places hit numbers and health bars over the world. Widgets come from per class pools
+ * and are added to the viewport once, every active marker is projected in one pass per frame
+ * from the view projection matrix of the first local player, and markers expire by time
+ * instead of one timer each.
+ */
+UCLASS()
+class SHOOTER_API UWorldUISubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	void ShowHitNumber(TSubclassOf<UHitNumberWidget> WidgetClass, int32 Damage, const FVector& Location, bool bHeadShot, float Lifetime);
+
+	// one bar per anchor, showing it again refreshes the percent and the lifetime
+	void ShowHealthBar(TSubclassOf<UHealthBarWidget> WidgetClass, AActor* Anchor, const FVector& Offset, float HealthPercent, float Lifetime);
+	void HideHealthBar(AActor* Anchor);
+
+	// places a widget made elsewhere until Lifetime runs out, then removes it from its parent
+	void AddWidgetMarker(UUserWidget* Widget, const FVector& Location, float Lifetime);
+
+	void Prewarm(TSubclassOf<UUserWidget> WidgetClass, int32 Count);
+
+	FORCEINLINE int32 GetMarkerCount() const { return MarkerWidgets.Num(); }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return MarkerWidgets.Num() > 0; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+private:
+	UUserWidget* AcquireWidget(UClass* WidgetClass, int32& OutPoolIndex);
+	UUserWidget* CreatePooledWidget(UClass* WidgetClass);
+	int32 FindOrAddPool(UClass* WidgetClass);
+
+	int32 AddMarker(UUserWidget* Widget, int32 PoolIndex, AActor* Anchor, const FVector& Location, float Lifetime);
+	void RemoveMarker(int32 Index);
+
+	// fills ScreenPositions for every marker, false when there is no view
+	bool ProjectMarkers();
+
+	UPROPERTY()
+	TArray<FWorldWidgetPool> Pools;
+
+	// active markers, struct of arrays so the projection pass walks plain locations
+	UPROPERTY()
+	TArray<UUserWidget*> MarkerWidgets;
+
+	// world location, or the offset from the anchor when there is one
+	TArray<FVector> MarkerLocations;
+	TArray<TWeakObjectPtr<AActor>> MarkerAnchors;
+	TArray<float> MarkerExpireTimes;
+	// INDEX_NONE for widgets made elsewhere
+	TArray<int32> MarkerPools;
+	TArray<bool> MarkerOnScreen;
+
+	// reused every frame
+	TArray<FVector> WorldPositions;
+	TArray<FVector2D> ScreenPositions;
+};